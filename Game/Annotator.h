@@ -0,0 +1,278 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../Models/Annotation.h"
+#include "../Models/Project_path.h"
+#include "Config.h"
+#include "Game_database.h"
+#include "Logger.h"
+#include "Logic.h"
+#include "Trace.h"
+#include "Transposition_table.h"
+
+inline void to_json(json &j, const move_annotation &m)    // Ход разбора в JSON (поля mark и missed_win — только если есть)
+{
+    j = json{{"ply", m.ply}, {"move", m.move}, {"score", m.score}, {"best", m.best}, {"best_score", m.best_score}, {"swing", m.swing}};
+    if (m.missed_win)
+        j["missed_win"] = true;
+    if (!m.mark.empty())
+        j["mark"] = m.mark;
+}
+
+inline void to_json(json &j, const game_annotation &a)    // Партия разбора — одна строка Annotate.Output
+{
+    j = json{{"game", a.game}, {"result", a.result}, {"blunders", a.blunders}, {"mistakes", a.mistakes}, {"missed_wins", a.missed_wins}, {"moves", a.moves}};
+}
+
+// Разбор партий (режим checkers --annotate и разбор только что сыгранной партии, если включён Annotate.AfterGame):
+// 1) партии повторяются генератором ходов, каждая позиция вместе с историей для правил ничьей — отдельное задание;
+// 2) задания всех партий сразу разбирают Annotate.Threads потоков: у каждого свой Logic, таблица позиций общая,
+//    поэтому соседние позиции партии используют результаты друг друга;
+// 3) оценка сделанного хода — оценка следующей позиции за соперника с обратным знаком. Ход, который теряет по
+//    сравнению с лучшим не меньше Annotate.Blunder (Annotate.Mistake), помечается "??" ("?"); упущенный выигрыш
+//    (позиция выиграна, а после хода — нет) отмечается отдельно.
+// Разбор дописывается в Annotate.Output по строке JSON на партию.
+template <class Rules>
+class Annotator
+{
+  public:
+    typedef typename Logic<Rules>::board_mtx board_mtx;
+    typedef king_rays<Rules::Size> rays;
+    static constexpr POS_T Size = Rules::Size;
+    static constexpr double Win_score = 100;    // Оценка выигранной позиции в шкале разбора
+
+    // table — общая таблица позиций (например, постоянный кэш бота); nullptr — своя таблица размером Annotate.HashMB
+    explicit Annotator(Config *config, Transposition_table *table = nullptr) : config(config), table(table), generator(nullptr, config)
+    {
+        if (!table)
+        {
+            own_table = std::make_unique<Transposition_table>(size_t((*config)("Annotate", "HashMB")));
+            this->table = own_table.get();
+        }
+        const int threads = (*config)("Annotate", "Threads");
+        threads_count = (threads > 0 ? threads : std::max(1, int(std::thread::hardware_concurrency())));
+    }
+
+    int run()   // Разбор последних Annotate.Games партий хранилища Database.GamesFile (0 — всех); 0 при успехе
+    {
+        const std::string games_path = project_path + std::string((*config)("Database", "GamesFile"));
+        std::string error;
+        Games_reader<Size> store;
+        if (!store.open(games_path, Logic<Rules>::rules_version(), error))
+        {
+            Logger::instance().error("Annotate error: " + error);
+            std::cout << "Annotate error: " << error << std::endl;
+            return 1;
+        }
+        std::vector<size_t> offsets;
+        game_record<Size> game;
+        for (size_t offset = store.begin(), next = offset; store.read(next, game); offset = next)
+            offsets.push_back(offset);
+        const size_t limit = (*config)("Annotate", "Games");
+        const size_t first = (limit > 0 && limit < offsets.size() ? offsets.size() - limit : 0);
+        std::vector<game_record<Size>> games(offsets.size() - first);
+        std::vector<size_t> numbers(games.size());
+        for (size_t i = 0; i < games.size(); ++i)
+        {
+            size_t offset = offsets[first + i];
+            store.read(offset, games[i]);
+            numbers[i] = first + i;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        const auto annotations = annotate(games, numbers);
+        if (!write(annotations))
+            return 1;
+        int blunders = 0, missed_wins = 0;
+        for (const auto &a : annotations)
+        {
+            blunders += a.blunders;
+            missed_wins += a.missed_wins;
+        }
+        const int time_ms = int(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        std::cout << "Annotated " << annotations.size() << " games in " << time_ms << " ms (" << threads_count
+                  << " threads), blunders: " << blunders << ", missed wins: " << missed_wins << std::endl;
+        return 0;
+    }
+
+    // Разбор партий; numbers — их номера для записи (номер в хранилище). Неправильные партии пропускаются.
+    std::vector<game_annotation> annotate(const std::vector<game_record<Size>> &games, const std::vector<size_t> &numbers)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<task> tasks;
+        std::vector<size_t> game_first; // Первое задание каждой принятой партии (и конец последней)
+        std::vector<size_t> accepted;
+        for (size_t g = 0; g < games.size(); ++g)
+        {
+            const size_t first = tasks.size();
+            if (!add_tasks(games[g], tasks))
+            {
+                tasks.resize(first);
+                Logger::instance().warning("Annotate: invalid game skipped", {{"game", numbers[g]}});
+                continue;
+            }
+            game_first.push_back(first);
+            accepted.push_back(g);
+        }
+        game_first.push_back(tasks.size());
+
+        std::vector<result> results(tasks.size());
+        std::atomic<size_t> next_task{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threads_count; ++t)
+        {
+            threads.emplace_back([&] {
+                TRACE_THREAD_NAME("annotator");
+                Logic<Rules> logic(nullptr, config);
+                logic.Max_depth = (*config)("Annotate", "Depth");
+                logic.set_table(table);
+                for (size_t i; (i = next_task++) < tasks.size();)
+                    analyze(logic, tasks[i], results[i]);
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+
+        std::vector<game_annotation> annotations;
+        for (size_t k = 0; k < accepted.size(); ++k)
+            annotations.push_back(make_annotation(games[accepted[k]], numbers[accepted[k]], &results[game_first[k]]));
+        const double time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        int blunders = 0, missed_wins = 0;
+        for (const auto &a : annotations)
+        {
+            blunders += a.blunders;
+            missed_wins += a.missed_wins;
+        }
+        Logger::instance().info("Annotate finished", {{"games", annotations.size()}, {"positions", tasks.size()}, {"threads", threads_count},
+                                                      {"blunders", blunders}, {"missed_wins", missed_wins}, {"time_ms", time_ms}});
+        return annotations;
+    }
+
+    bool write(const std::vector<game_annotation> &annotations) const  // Дописывает разбор в Annotate.Output
+    {
+        const std::string path = project_path + std::string((*config)("Annotate", "Output"));
+        std::ofstream fout(path, std::ios_base::app);
+        for (const auto &a : annotations)
+            fout << json(a).dump() << '\n';
+        if (!fout)
+        {
+            Logger::instance().error("Annotate error: can't write " + path);
+            return false;
+        }
+        return true;
+    }
+
+    static std::string notation(const game_move<Size> &move)   // Ход в виде "c3-d4", взятие — "c3:e5"
+    {
+        return square_name(move.from) + (move.captured ? ":" : "-") + square_name(move.to);
+    }
+
+  private:
+    struct task // Позиция партии
+    {
+        board_mtx mtx;
+        bool color;
+        std::vector<uint64_t> history;  // Ключи с последнего необратимого хода (последний — эта позиция)
+    };
+
+    struct result
+    {
+        double score = 0;   // Оценка для стороны, которая ходит (в шкале calc_score)
+        std::vector<move_pos> best; // Лучший ход (пусто — ходов нет или ничья по правилам)
+    };
+
+    bool add_tasks(const game_record<Size> &game, std::vector<task> &tasks)   // Позиции партии от начальной до последней
+    {
+        Logic<Rules> &logic = generator;
+        board_mtx mtx = Logic<Rules>::start_position();
+        bool color = false;
+        std::vector<uint64_t> keys{logic.history_key(mtx, color)};
+        tasks.push_back({mtx, color, keys});
+        for (const auto &move : game.moves)
+        {
+            const auto turns = logic.legal_turns(mtx, color);
+            const auto it = std::find_if(turns.begin(), turns.end(), [&](const std::vector<move_pos> &turn) { return move.matches(turn); });
+            if (it == turns.end())
+                return false;
+            const bool reversible = (it->size() == 1 && Logic<Rules>::is_reversible(mtx, it->front()));
+            mtx = logic.apply_turns(mtx, *it);
+            color = !color;
+            if (!reversible)
+                keys.clear();
+            keys.push_back(logic.history_key(mtx, color));
+            tasks.push_back({mtx, color, keys});
+        }
+        return true;
+    }
+
+    static void analyze(Logic<Rules> &logic, const task &position, result &res)
+    {
+        TRACE_ZONE("annotate", "position");
+        logic.set_history(position.history);
+        if (logic.is_draw())
+        {
+            res.score = DRAW_SCORE;
+            return;
+        }
+        res.best = logic.find_best_turns(position.mtx, position.color);
+        res.score = (res.best.empty() ? 0 : logic.last_stats().score);  // Нет ходов — проигрыш
+    }
+
+    game_annotation make_annotation(const game_record<Size> &game, const size_t number, const result *results) const
+    {
+        const double mistake = (*config)("Annotate", "Mistake");
+        const double blunder = (*config)("Annotate", "Blunder");
+        game_annotation a;
+        a.game = number;
+        a.result = (game.result == Game_result::WHITE ? "white" : game.result == Game_result::BLACK ? "black" : "draw");
+        for (size_t ply = 0; ply < game.moves.size(); ++ply)
+        {
+            const result &before = results[ply], &after = results[ply + 1];
+            move_annotation m;
+            m.ply = int(ply);
+            m.move = notation(game.moves[ply]);
+            m.best_score = to_scale(before.score);
+            m.score = 0 - to_scale(after.score);    // Не -x: ноль без знака
+            if (!before.best.empty())
+            {
+                m.best = notation(game_move<Size>::make(before.best));
+                if (!game.moves[ply].matches(before.best))
+                    m.swing = std::max(0.0, std::round((m.best_score - m.score) * 1000) / 1000);
+            }
+            m.missed_win = (before.score >= INF && after.score > 0);
+            m.mark = (m.swing >= blunder ? "??" : m.swing >= mistake ? "?" : "");
+            a.blunders += (m.mark == "??");
+            a.mistakes += (m.mark == "?");
+            a.missed_wins += m.missed_win;
+            a.moves.push_back(m);
+        }
+        return a;
+    }
+
+    static double to_scale(const double ratio)  // Оценка поиска (отношение) в шкалу разбора: ln отношения, выигрыш — Win_score
+    {
+        if (ratio >= INF)
+            return Win_score;
+        if (ratio <= 0)
+            return -Win_score;
+        return std::round(std::clamp(std::log(ratio), -Win_score, Win_score) * 1000) / 1000;
+    }
+
+    static std::string square_name(const int k)    // "a1" — левый нижний угол со стороны белых
+    {
+        return std::string(1, char('a' + rays::col(k))) + std::to_string(Size - rays::row(k));
+    }
+
+    Config *config;
+    Transposition_table *table; // Общая таблица позиций потоков
+    std::unique_ptr<Transposition_table> own_table; // Своя таблица, если общую не передали
+    Logic<Rules> generator; // Генератор ходов для повторения партий
+    int threads_count = 1;
+};
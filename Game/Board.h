@@ -1,10 +1,14 @@
 #pragma once
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <functional>
 #include <vector>
 
 #include "../Models/Move.h"
 #include "../Models/Project_path.h"
+#include "Logger.h"
+#include "Trace.h"
 
 #ifdef __APPLE__
     #include <SDL2/SDL.h>
@@ -20,7 +24,8 @@ class Board
 {
 public:
     Board() = default;  // Конструктор по умолчанию, не инициализирует ничего
-    Board(const unsigned int W, const unsigned int H) : W(W), H(H)  // Конструктор с заданием размеров окна (W — ширина, H — высота)
+    Board(const unsigned int W, const unsigned int H, const POS_T size = 8)  // Конструктор с заданием размеров окна (W — ширина, H — высота) и размера доски
+        : W(W), H(H), size(size), is_highlighted_(size, vector<bool>(size, 0)), mtx(size, vector<POS_T>(size, 0))
     {
     }
 
@@ -51,6 +56,8 @@ public:
             return 1;
         }
         ren = SDL_CreateRenderer(win, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);  // Создание рендерера с ускорением и VSync
+        if (ren == nullptr)  // Без ускорения (например, видеодрайвер dummy без экрана) — программный рендерер
+            ren = SDL_CreateRenderer(win, -1, SDL_RENDERER_SOFTWARE);
         if (ren == nullptr)  // Проверка на ошибку создания рендерера
         {
             print_exception("SDL_CreateRenderer can't create renderer");
@@ -82,18 +89,20 @@ public:
         make_start_mtx();  // Создание начальной матрицы доски
         clear_active();  // Убрать активную клетку
         clear_highlight();  // Убрать подсветку
+        clear_hints();  // Убрать подсказку
     }
 
-    void move_piece(move_pos turn, const int beat_series = 0)  // Перемещение шашки с учётом битья: очищает съеденную шашку, вызывает базовое перемещение
+    void move_piece(move_pos turn, const int beat_series = 0, const bool can_crown = true)  // Перемещение шашки с учётом битья: очищает съеденную шашку, вызывает базовое перемещение
     {
         if (turn.xb != -1)  // Если есть съеденная шашка
         {
             mtx[turn.xb][turn.yb] = 0;  // Очистка съеденной клетки
         }
-        move_piece(turn.x, turn.y, turn.x2, turn.y2, beat_series);  // Вызов базового перемещения
+        move_piece(turn.x, turn.y, turn.x2, turn.y2, beat_series, can_crown);  // Вызов базового перемещения
     }
 
-    void move_piece(const POS_T i, const POS_T j, const POS_T i2, const POS_T j2, const int beat_series = 0)  // Базовое перемещение: проверяет клетки, обновляет матрицу, добавляет в историю
+    // can_crown = false, если правила варианта запрещают превращение на этом ходу (например, серия битья продолжается)
+    void move_piece(const POS_T i, const POS_T j, const POS_T i2, const POS_T j2, const int beat_series = 0, const bool can_crown = true)  // Базовое перемещение: проверяет клетки, обновляет матрицу, добавляет в историю
     {
         if (mtx[i2][j2]) // Проверка, свободна ли конечная клетка
         {
@@ -103,7 +112,7 @@ public:
         {
             throw runtime_error("begin position is empty, can't move");
         }
-        if ((mtx[i][j] == 1 && i2 == 0) || (mtx[i][j] == 2 && i2 == 7)) // Преобразование в дамку при достижении края
+        if (can_crown && ((mtx[i][j] == 1 && i2 == 0) || (mtx[i][j] == 2 && i2 == size - 1))) // Преобразование в дамку при достижении края
             mtx[i][j] += 2;
         mtx[i2][j2] = mtx[i][j];    // Перемещение шашки
         drop_piece(i, j);   // Очистка начальной позиции
@@ -142,9 +151,9 @@ public:
 
     void clear_highlight()  // Убирает всю подсветку с доски
     {
-        for (POS_T i = 0; i < 8; ++i)   // Очистка матрицы подсветки
+        for (POS_T i = 0; i < size; ++i)   // Очистка матрицы подсветки
         {
-            is_highlighted_[i].assign(8, 0);
+            is_highlighted_[i].assign(size, 0);
         }
         rerender(); // Перерисовка
     }
@@ -163,6 +172,20 @@ public:
         rerender(); // Перерисовка
     }
 
+    void set_hints(vector<vector<pair<POS_T, POS_T>>> paths)  // Показывает подсказку: пути лучших ходов (клетка начала и клетки после каждого взятия), первый — лучший
+    {
+        hints = move(paths);
+        rerender(); // Обновление отображения
+    }
+
+    void clear_hints()  // Убирает подсказку с доски
+    {
+        if (hints.empty())
+            return;
+        hints.clear();
+        rerender(); // Перерисовка
+    }
+
     bool is_highlighted(const POS_T x, const POS_T y)   // Проверяет, подсвечена ли указанная клетка
     {
         return is_highlighted_[x][y];
@@ -187,6 +210,16 @@ public:
         rerender(); // Перерисовка с отображением результата
     }
 
+    void set_frame_listener(function<void(double)> listener)  // Подписка на кадры: вызывается после показа каждого кадра с временем его отрисовки в мс
+    {
+        on_frame = move(listener);
+    }
+
+    void set_title(const string &title)  // Заголовок окна (например, статистика позиции по базе партий)
+    {
+        SDL_SetWindowTitle(win, title.c_str());
+    }
+
     // use if window size changed
     void reset_window_size()    // Перерисовка с отображением результата
     {
@@ -223,14 +256,15 @@ private:
     // function to make start matrix
     void make_start_mtx()
     {
-        for (POS_T i = 0; i < 8; ++i)   // Заполнение матрицы начальными позициями
+        const POS_T rows = (size - 2) / 2;  // Количество рядов шашек у каждого игрока (3 для 8x8, 4 для 10x10)
+        for (POS_T i = 0; i < size; ++i)   // Заполнение матрицы начальными позициями
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (POS_T j = 0; j < size; ++j)
             {
                 mtx[i][j] = 0;
-                if (i < 3 && (i + j) % 2 == 1)  // Установка чёрных шашек
+                if (i < rows && (i + j) % 2 == 1)  // Установка чёрных шашек
                     mtx[i][j] = 2;
-                if (i > 4 && (i + j) % 2 == 1)  // Установка белых шашек
+                if (i >= size - rows && (i + j) % 2 == 1)  // Установка белых шашек
                     mtx[i][j] = 1;
             }
         }
@@ -240,20 +274,26 @@ private:
     // function that re-draw all the textures
     void rerender()
     {
+        TRACE_ZONE("render", "rerender");
+        const auto frame_start = chrono::steady_clock::now();
         // draw board
+        const int cells = size + 2; // Клеток по стороне окна вместе с полями
         SDL_RenderClear(ren);
-        SDL_RenderCopy(ren, board, NULL, NULL);
+        if (size == 8)
+            SDL_RenderCopy(ren, board, NULL, NULL);
+        else
+            draw_plain_board(); // Для досок другого размера текстуры нет — рисуем клетки
 
         // draw pieces
-        for (POS_T i = 0; i < 8; ++i)
+        for (POS_T i = 0; i < size; ++i)
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (POS_T j = 0; j < size; ++j)
             {
                 if (!mtx[i][j]) // Пропуск пустых клеток
                     continue;
-                int wpos = W * (j + 1) / 10 + W / 120;  // Расчёт позиции X
-                int hpos = H * (i + 1) / 10 + H / 120;  // Расчёт позиции Y
-                SDL_Rect rect{ wpos, hpos, W / 12, H / 12 };    // Определение области для шашки
+                int wpos = W * (j + 1) / cells + W / 12 / cells;  // Расчёт позиции X
+                int hpos = H * (i + 1) / cells + H / 12 / cells;  // Расчёт позиции Y
+                SDL_Rect rect{ wpos, hpos, W * 10 / 12 / cells, H * 10 / 12 / cells };    // Определение области для шашки
 
                 SDL_Texture* piece_texture; // Выбор текстуры шашки
                 if (mtx[i][j] == 1)
@@ -270,17 +310,36 @@ private:
         }
 
         // draw hilight
-        SDL_SetRenderDrawColor(ren, 0, 255, 0, 0);  // Установка цвета подсветки (зелёный)
         const double scale = 2.5;   // Масштаб для подсветки
         SDL_RenderSetScale(ren, scale, scale);  // Применение масштаба
-        for (POS_T i = 0; i < 8; ++i)   // Отрисовка подсветки
+        for (size_t r = hints.size(); r-- > 0;)   // Отрисовка подсказки: худший вариант первым, лучший поверх остальных
+        {
+            const Uint8 shade = Uint8(max(60, 220 - 70 * int(r)));  // Чем ниже место варианта, тем темнее синий
+            SDL_SetRenderDrawColor(ren, 0, shade, 255, 0);
+            const auto& path = hints[r];
+            for (size_t k = 1; k < path.size(); ++k)    // Линии между центрами клеток хода
+            {
+                SDL_RenderDrawLine(ren, int((W * (path[k - 1].second + 1) / cells + W / cells / 2) / scale),
+                                   int((H * (path[k - 1].first + 1) / cells + H / cells / 2) / scale),
+                                   int((W * (path[k].second + 1) / cells + W / cells / 2) / scale),
+                                   int((H * (path[k].first + 1) / cells + H / cells / 2) / scale));
+            }
+            if (!path.empty())  // Рамка вокруг конечной клетки
+            {
+                SDL_Rect cell{ int(W * (path.back().second + 1) / cells / scale), int(H * (path.back().first + 1) / cells / scale),
+                               int(W / cells / scale), int(H / cells / scale) };
+                SDL_RenderDrawRect(ren, &cell);
+            }
+        }
+        SDL_SetRenderDrawColor(ren, 0, 255, 0, 0);  // Установка цвета подсветки (зелёный)
+        for (POS_T i = 0; i < size; ++i)   // Отрисовка подсветки
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (POS_T j = 0; j < size; ++j)
             {
                 if (!is_highlighted_[i][j]) // Пропуск неподсвеченных клеток
                     continue;
-                SDL_Rect cell{ int(W * (j + 1) / 10 / scale), int(H * (i + 1) / 10 / scale), int(W / 10 / scale),
-                              int(H / 10 / scale) };    // Определение области клетки
+                SDL_Rect cell{ int(W * (j + 1) / cells / scale), int(H * (i + 1) / cells / scale), int(W / cells / scale),
+                              int(H / cells / scale) };    // Определение области клетки
                 SDL_RenderDrawRect(ren, &cell); // Отрисовка прямоугольника подсветки
             }
         }
@@ -289,16 +348,16 @@ private:
         if (active_x != -1)
         {
             SDL_SetRenderDrawColor(ren, 255, 0, 0, 0);  // Установка цвета активной клетки (красный)
-            SDL_Rect active_cell{ int(W * (active_y + 1) / 10 / scale), int(H * (active_x + 1) / 10 / scale),   // Определение области
-                                 int(W / 10 / scale), int(H / 10 / scale) };
+            SDL_Rect active_cell{ int(W * (active_y + 1) / cells / scale), int(H * (active_x + 1) / cells / scale),   // Определение области
+                                 int(W / cells / scale), int(H / cells / scale) };
             SDL_RenderDrawRect(ren, &active_cell);  // Отрисовка активной клетки
         }
         SDL_RenderSetScale(ren, 1, 1);  // Сброс масштаба
 
         // draw arrows
-        SDL_Rect rect_left{ W / 40, H / 40, W / 15, H / 15 };   // Позиция и размер кнопки "назад"
+        SDL_Rect rect_left{ W / 4 / cells, H / 4 / cells, W * 2 / 3 / cells, H * 2 / 3 / cells };   // Позиция и размер кнопки "назад"
         SDL_RenderCopy(ren, back, NULL, &rect_left);    // Отрисовка кнопки "назад"
-        SDL_Rect replay_rect{ W * 109 / 120, H / 40, W / 15, H / 15 };  // Позиция и размер кнопки "повтор"
+        SDL_Rect replay_rect{ W - W / 4 / cells - W * 2 / 3 / cells, H / 4 / cells, W * 2 / 3 / cells, H * 2 / 3 / cells };  // Позиция и размер кнопки "повтор"
         SDL_RenderCopy(ren, replay, NULL, &replay_rect);    // Отрисовка кнопки "повтор"
 
         // draw result
@@ -320,22 +379,49 @@ private:
             SDL_DestroyTexture(result_texture);  // Освобождение памяти
         }
 
-        SDL_RenderPresent(ren);  // Показ отрисовки
+        {
+            TRACE_ZONE("render", "SDL_RenderPresent");
+            SDL_RenderPresent(ren);  // Показ отрисовки
+        }
+        if (on_frame)
+            on_frame(chrono::duration<double, milli>(chrono::steady_clock::now() - frame_start).count());
         // next rows for mac os
-        SDL_Delay(10);  // Задержка для совместимости с Mac
+        {
+            TRACE_ZONE("render", "SDL_Delay");
+            SDL_Delay(10);  // Задержка для совместимости с Mac
+        }
         SDL_Event windowEvent;
         SDL_PollEvent(&windowEvent);  // Обработка событий
     }
 
-    void print_exception(const string& text) {  // Логирует ошибку в файл log.txt с описанием и SDL_GetError()
-        ofstream fout(project_path + "log.txt", ios_base::app);
-        fout << "Error: " << text << ". "<< SDL_GetError() << endl;
-        fout.close();
+    void draw_plain_board() // Рисует доску произвольного размера цветными клетками (для 8x8 используется текстура)
+    {
+        const int cells = size + 2;
+        SDL_SetRenderDrawColor(ren, 120, 72, 40, 0);    // Поля вокруг доски
+        SDL_RenderFillRect(ren, NULL);
+        for (POS_T i = 0; i < size; ++i)
+        {
+            for (POS_T j = 0; j < size; ++j)
+            {
+                if ((i + j) % 2)
+                    SDL_SetRenderDrawColor(ren, 110, 60, 30, 0);   // Тёмная клетка
+                else
+                    SDL_SetRenderDrawColor(ren, 240, 217, 181, 0);  // Светлая клетка
+                SDL_Rect cell{ W * (j + 1) / cells, H * (i + 1) / cells, W * (j + 2) / cells - W * (j + 1) / cells,
+                               H * (i + 2) / cells - H * (i + 1) / cells };
+                SDL_RenderFillRect(ren, &cell);
+            }
+        }
+    }
+
+    void print_exception(const string& text) {  // Логирует ошибку в log.txt с описанием и SDL_GetError()
+        Logger::instance().error("Error: " + text + ". " + SDL_GetError());
     }
 
   public:
     int W = 0;  // Ширина окна
     int H = 0;  // Высота окна
+    POS_T size = 8; // Размер доски (клеток по стороне): 8 или 10 в зависимости от варианта правил
     // history of boards
     vector<vector<vector<POS_T>>> history_mtx;  // История состояний доски
 
@@ -366,6 +452,8 @@ private:
     int active_x = -1, active_y = -1;  // Координаты выбранной клетки
     // game result if exist
     int game_results = -1;  // Результат игры (1 — белые, 2 — чёрные, 0 — ничья, -1 — не завершена)
+    // hint lines
+    vector<vector<pair<POS_T, POS_T>>> hints;  // Подсказка: пути лучших ходов по убыванию оценки (пусто — подсказка скрыта)
     // matrix of possible moves
     vector<vector<bool>> is_highlighted_ = vector<vector<bool>>(8, vector<bool>(8, 0));  // Матрица подсветки клеток
     // matrix of possible moves
@@ -373,4 +461,5 @@ private:
     vector<vector<POS_T>> mtx = vector<vector<POS_T>>(8, vector<POS_T>(8, 0));  // Матрица доски (0 — пусто, 1 — белая шашка, 2 — чёрная шашка, 3 — белая дамка, 4 — чёрная дамка)
     // series of beats for each move
     vector<int> history_beat_series;  // История серий битья
+    function<void(double)> on_frame;  // Подписчик на показанные кадры (замер отзывчивости интерфейса)
 };
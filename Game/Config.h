@@ -20,7 +20,7 @@ class Config
         fin.close();
     }
 
-    auto operator()(const string &setting_dir, const string &setting_name) const    // Перегрузка оператора () для удобного доступа к значениям конфигурации по разделу и имени настройки (например, config("Bot", "IsWhiteBot"))
+    auto operator()(const std::string &setting_dir, const std::string &setting_name) const    // Перегрузка оператора () для удобного доступа к значениям конфигурации по разделу и имени настройки (например, config("Bot", "IsWhiteBot"))
     {
         return config[setting_dir][setting_name];
     }
@@ -0,0 +1,208 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../Models/Project_path.h"
+#include "Config.h"
+#include "Game_database.h"
+#include "Logger.h"
+#include "Logic.h"
+
+// Построение индекса базы партий (режим checkers --build-db):
+// 1) партии хранилища Database.GamesFile повторяются генератором ходов Logic; партия с ходом, которого нет среди
+//    допустимых, пропускается (ошибка пишется в лог), поэтому в индекс попадают только правильные партии;
+// 2) каждая позиция (вместе с очередью хода) даёт ссылку «ключ, партия, полуход», ссылки сортируются по ключу;
+// 3) из групп одинаковых ключей получаются статистика позиций и списки партий, индекс пишется во временный файл
+//    и переименовывается в Database.IndexFile, так что игра, открывшая старый индекс, продолжает его читать.
+template <class Rules>
+class Database_builder
+{
+  public:
+    typedef typename Logic<Rules>::board_mtx board_mtx;
+    static constexpr POS_T Size = Rules::Size;
+
+    explicit Database_builder(Config *config) : config(config), logic(nullptr, config)
+    {
+    }
+
+    int run()   // Построение индекса; 0 при успехе
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const std::string games_path = project_path + std::string((*config)("Database", "GamesFile"));
+        const std::string index_path = project_path + std::string((*config)("Database", "IndexFile"));
+        std::string error;
+        Games_reader<Size> store;
+        if (!store.open(games_path, Logic<Rules>::rules_version(), error))
+        {
+            Logger::instance().error("Database error: " + error);
+            std::cout << "Database error: " << error << std::endl;
+            return 1;
+        }
+        collect(store);
+        std::sort(entries.begin(), entries.end());
+        if (!write(index_path, store.size()))
+        {
+            Logger::instance().error("Database error: can't write " + index_path);
+            std::cout << "Database error: can't write " << index_path << std::endl;
+            return 1;
+        }
+        const int build_ms = int(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        Logger::instance().info("Database index written", {{"file", index_path}, {"games", offsets.size()}, {"skipped", skipped},
+                                                           {"positions", positions}, {"refs", refs}, {"time_ms", build_ms}});
+        std::cout << "Indexed " << offsets.size() << " games (" << skipped << " skipped), " << positions << " positions in "
+                  << build_ms << " ms" << std::endl;
+        return benchmark(index_path, games_path);
+    }
+
+  private:
+    struct entry    // Позиция партии
+    {
+        uint64_t key;
+        uint32_t game;
+        uint16_t ply;
+        Game_result result;
+
+        bool operator<(const entry &other) const    // По ключу, внутри — по партии и полуходу
+        {
+            return key != other.key ? key < other.key : game != other.game ? game < other.game : ply < other.ply;
+        }
+    };
+
+    void collect(const Games_reader<Size> &store)   // Повторяет партии хранилища и собирает их позиции
+    {
+        game_record<Size> game;
+        size_t offset = store.begin();
+        for (size_t next = offset; store.read(next, game); offset = next)
+        {
+            const size_t first = entries.size();
+            const uint32_t index = uint32_t(offsets.size());
+            if (game.result == Game_result::UNKNOWN || !replay(game, index))
+            {
+                entries.resize(first);
+                Logger::instance().warning("Database: invalid game skipped", {{"offset", offset}});
+                ++skipped;
+                continue;
+            }
+            offsets.push_back(offset);
+        }
+        if (offset != store.size())
+            Logger::instance().warning("Database: damaged tail of the games file ignored", {{"offset", offset}, {"size", store.size()}});
+    }
+
+    bool replay(const game_record<Size> &game, const uint32_t index)   // Проверяет ходы партии генератором и добавляет её позиции
+    {
+        board_mtx mtx = Logic<Rules>::start_position();
+        bool color = false;
+        entries.push_back({logic.history_key(mtx, color), index, 0, game.result});
+        for (size_t ply = 0; ply < game.moves.size(); ++ply, color = !color)
+        {
+            const auto turns = logic.legal_turns(mtx, color);
+            const auto it = std::find_if(turns.begin(), turns.end(), [&](const std::vector<move_pos> &turn) { return game.moves[ply].matches(turn); });
+            if (it == turns.end())
+                return false;
+            mtx = logic.apply_turns(mtx, *it);
+            entries.push_back({logic.history_key(mtx, !color), index, uint16_t(ply + 1), game.result});
+        }
+        return true;
+    }
+
+    bool write(const std::string &path, const uint64_t games_size)  // Индекс из отсортированных позиций
+    {
+        std::vector<position_stats> stats;
+        std::vector<game_ref> game_refs;
+        game_refs.reserve(entries.size());
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            const entry &e = entries[i];
+            if (stats.empty() || stats.back().key != e.key)
+            {
+                stats.emplace_back();
+                stats.back().key = e.key;
+                stats.back().first = game_refs.size();
+            }
+            else if (entries[i - 1].game == e.game)
+                continue;   // Повторение позиции в той же партии
+            position_stats &s = stats.back();
+            ++s.games;
+            s.white += (e.result == Game_result::WHITE);
+            s.black += (e.result == Game_result::BLACK);
+            s.draws += (e.result == Game_result::DRAW);
+            game_refs.push_back({e.game, e.ply, 0});
+        }
+        std::vector<uint64_t> directory(Game_database<Size>::Buckets + 1);
+        for (size_t bucket = 0, i = 0; bucket <= Game_database<Size>::Buckets; ++bucket)
+        {
+            while (i < stats.size() && (stats[i].key >> 48) < bucket)
+                ++i;
+            directory[bucket] = i;
+        }
+        directory.back() = stats.size();
+
+        index_header header;
+        header.board_size = Size;
+        header.rules = Logic<Rules>::rules_version();
+        header.positions = stats.size();
+        header.refs = game_refs.size();
+        header.games = offsets.size();
+        header.games_size = games_size;
+        positions = stats.size();
+        refs = game_refs.size();
+
+        const std::string temp = path + ".tmp";
+        {
+            std::ofstream fout(temp, std::ios_base::binary | std::ios_base::trunc);
+            fout.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            fout.write(reinterpret_cast<const char *>(directory.data()), directory.size() * sizeof(uint64_t));
+            fout.write(reinterpret_cast<const char *>(stats.data()), stats.size() * sizeof(position_stats));
+            fout.write(reinterpret_cast<const char *>(game_refs.data()), game_refs.size() * sizeof(game_ref));
+            fout.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+            if (!fout)
+                return false;
+        }
+#ifdef _WIN32
+        std::remove(path.c_str());  // rename на Windows не заменяет существующий файл
+#endif
+        return std::rename(temp.c_str(), path.c_str()) == 0;
+    }
+
+    int benchmark(const std::string &index_path, const std::string &games_path) const   // Открывает готовый индекс и замеряет поиск позиций
+    {
+        Game_database<Size> db;
+        std::string error;
+        if (!db.open(index_path, games_path, Logic<Rules>::rules_version(), error))
+        {
+            Logger::instance().error("Database error: " + error);
+            std::cout << "Database error: " << error << std::endl;
+            return 1;
+        }
+        if (entries.empty())
+            return 0;
+        const size_t lookups = 1 << 20;
+        std::vector<uint64_t> keys(lookups);
+        std::default_random_engine rng(0);
+        std::uniform_int_distribution<size_t> pick(0, entries.size() - 1);
+        for (auto &key : keys)
+            key = entries[pick(rng)].key;
+        const auto start = std::chrono::steady_clock::now();
+        size_t found = 0;
+        for (const uint64_t key : keys)
+            found += (db.find(key) != nullptr);
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / lookups;
+        Logger::instance().info("Database lookup", {{"lookups", lookups}, {"found", found}, {"ns_per_lookup", ns}});
+        std::cout << "Lookup: " << ns << " ns per position" << std::endl;
+        return found == lookups ? 0 : 1;
+    }
+
+    Config *config;
+    Logic<Rules> logic; // Генератор ходов и ключи позиций
+    std::vector<entry> entries; // Позиции всех партий
+    std::vector<uint64_t> offsets;  // Смещения принятых партий в хранилище
+    size_t skipped = 0; // Пропущенных партий
+    size_t positions = 0;
+    size_t refs = 0;
+};
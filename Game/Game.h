@@ -1,20 +1,60 @@
 #pragma once
+#include <algorithm>
 #include <chrono>
+#include <memory>
 #include <thread>
 
 #include "../Models/Project_path.h"
+#include "Annotator.h"
 #include "Board.h"
 #include "Config.h"
+#include "Game_database.h"
 #include "Hand.h"
+#include "Input_log.h"
+#include "Logger.h"
 #include "Logic.h"
+#include "Solver.h"
+#include "Trace.h"
+#include "Training_data.h"
 
+template <class Rules> // Правила варианта шашек (Models/Rules.h)
 class Game
 {
   public:
-    Game() : board(config("WindowSize", "Width"), config("WindowSize", "Hight")), hand(&board), logic(&board, &config)
+    Game() : board(config("WindowSize", "Width"), config("WindowSize", "Hight"), Rules::Size), hand(&board), logic(&board, &config)
     {
-        ofstream fout(project_path + "log.txt", ios_base::trunc);
-        fout.close();
+        Logger::instance().open(project_path + "log.txt");
+        Logger::instance().set_level(Logger::level_from_string(config("Log", "Level")));
+        subscribe_stats();
+        open_training();
+        open_solver();
+        open_cache();
+        open_database();
+        const string driver = config("Ui", "VideoDriver");
+        if (!driver.empty())    // Например, "dummy" или "offscreen" — окно без экрана (замер интерфейса на сервере сборки)
+            SDL_SetHint(SDL_HINT_VIDEODRIVER, driver.c_str());
+    }
+
+    // Игра с записью ввода в Ui.InputFile (replay = false) или с воспроизведением ввода из него; по окончании — замер
+    // отзывчивости интерфейса в Ui.StatsFile. 0, если задержка и число кадров на взаимодействие не превысили пороги Ui
+    int play_input_log(const bool replay)
+    {
+        Input_log input;
+        string error;
+        if (!input.open(project_path + string(config("Ui", "InputFile")), replay, error))
+        {
+            Logger::instance().error("Input log error: " + error);
+            cerr << "Input log error: " << error << endl;
+            return 1;
+        }
+        input.set_real_time(config("Ui", "RealTime"));
+        hand.set_input(&input);
+        board.set_frame_listener([&input](const double render_ms) { input.frame(render_ms); });
+        play();
+        hand.set_input(nullptr);
+        board.set_frame_listener(nullptr);
+        const string stats_file = config("Ui", "StatsFile");
+        return input.report(stats_file.empty() ? "" : project_path + stats_file, config("Ui", "MaxLatencyMs"), config("Ui", "MaxFramesPerInteraction")) ? 0 : 1;
     }
 
     // to start checkers
@@ -23,8 +63,13 @@ class Game
         auto start = chrono::steady_clock::now();   // Запуск таймера для измерения времени игры
         if (is_replay)  // Если режим повтора: перезагружает логику, конфиг и доску
         {
-            logic = Logic(&board, &config);
+            logic = Logic<Rules>(&board, &config);
             config.reload();
+            subscribe_stats();
+            open_training();
+            open_solver();
+            open_cache();
+            open_database();
             board.redraw();
         }
         else  // Иначе: инициализирует доску для новой игры
@@ -35,13 +80,21 @@ class Game
 
         int turn_num = -1;  // Инициализация номера хода
         bool is_quit = false;   // Флаг выхода из игры
+        bool is_draw = false;   // Ничья по правилам (повторение позиции, ходы одними дамками)
         const int Max_turns = config("Game", "MaxNumTurns");    // Получение максимального числа ходов из конфига
         while (++turn_num < Max_turns)  // Цикл по ходам, пока не достигнут лимит
         {
+            TRACE_ZONE_ARG("game", "turn", "turn", turn_num);
             beat_series = 0;    // Сброс серии битья
             logic.find_turns(turn_num % 2); // Поиск ходов для текущего цвета (0 — белые, 1 — чёрные)
             if (logic.turns.empty())
                 break;  // Нет ходов — конец игры
+            show_position_stats(turn_num % 2);
+            if (logic.is_draw(turn_num % 2))
+            {
+                is_draw = true;
+                break;  // Ничья по правилам — доигрывать до лимита ходов незачем
+            }
             logic.Max_depth = config("Bot", string((turn_num % 2) ? "Black" : "White") + string("BotLevel"));   // Установка глубины для бота
             if (!config("Bot", string("Is") + string((turn_num % 2) ? "Black" : "White") + string("Bot")))  // Если ход игрока
             {
@@ -76,16 +129,21 @@ class Game
                 bot_turn(turn_num % 2); // Ход бота
         }
         auto end = chrono::steady_clock::now(); // Остановка таймера
-        ofstream fout(project_path + "log.txt", ios_base::app); // Логирование времени игры
-        fout << "Game time: " << (int)chrono::duration<double, milli>(end - start).count() << " millisec\n";
-        fout.close();
+        int game_ms = (int)chrono::duration<double, milli>(end - start).count();    // Логирование времени игры
+        Logger::instance().info("Game time: " + to_string(game_ms) + " millisec", {{"turns", turn_num}, {"draw_by_rules", is_draw}});
 
         if (is_replay)  // Рекурсивный вызов для повтора
+        {
+            training.discard_game();    // Партия не доиграна — результат позиций неизвестен
             return play();
+        }
         if (is_quit)    // Выход
+        {
+            training.discard_game();
             return 0;
+        }
         int res = 2;    // Победа чёрных по умолчанию
-        if (turn_num == Max_turns)  // Ничья по лимиту ходов
+        if (turn_num == Max_turns || is_draw)  // Ничья по лимиту ходов или по правилам
         {
             res = 0;
         }
@@ -93,7 +151,16 @@ class Game
         {
             res = 1;
         }
+        const Game_result result = (res == 0 ? Game_result::DRAW : res == 1 ? Game_result::WHITE : Game_result::BLACK);
+        training.end_game(result);
+        game_record<Rules::Size> game;
+        const bool restored = restore_game(result, game);
+        if (restored && games.is_open() && !games.append(game))
+            Logger::instance().error("Game database error: can't write the game");
+        flush_cache(true);
         board.show_final(res);  // Показ результата
+        if (restored && config("Annotate", "AfterGame"))  // Разбор партии, пока показан результат
+            annotate_game(game);
         auto resp = hand.wait();    // Ожидание ввода после результата
         if (resp == Response::REPLAY)   // Повтор игры
         {
@@ -104,15 +171,192 @@ class Game
     }
 
   private:
+    void subscribe_stats()  // Подписывает запись статистики поиска в search_stats.jsonl (по строке JSON на ход бота), если включено в настройках
+    {
+        if (!config("Bot", "StatsLog"))
+        {
+            logic.set_stats_listener(nullptr);
+            return;
+        }
+        logic.set_stats_listener([](const search_stats &stats) {
+            ofstream fout(project_path + "search_stats.jsonl", ios_base::app);
+            fout << json(stats).dump() << '\n';
+            fout.close();
+        });
+    }
+
+    void open_training()    // Открывает файл обучающих данных Bot.TrainingFile (пустая строка — позиции не записываются)
+    {
+        const string file = config("Bot", "TrainingFile");
+        if (file.empty())
+        {
+            training.close();
+            return;
+        }
+        string error;
+        if (!training.open(project_path + file, Logic<Rules>::rules_version(), error))
+            Logger::instance().error("Training data error: " + error);
+    }
+
+    void open_solver()  // Создаёт решатель эндшпилей, если Solver.Pieces > 0, и загружает кэш решённых позиций Solver.CacheFile
+    {
+        unsolved_pieces = 0;
+        if (int(config("Solver", "Pieces")) <= 0)
+        {
+            solver.reset();
+            return;
+        }
+        const string file = config("Solver", "CacheFile");
+        string error;
+        if (!file.empty() && !solved.is_open() && !solved.open(project_path + file, Rules::Size, Logic<Rules>::rules_version(), error))
+            Logger::instance().error("Solver cache error: " + error);
+        solver = make_unique<Solver<Rules>>(&config, &solved);
+    }
+
+    void open_cache()   // Подключает к боту постоянную таблицу позиций Cache.File (пустая строка — поиск без таблицы)
+    {
+        cache.reset();
+        const string file = config("Cache", "File");
+        if (file.empty())
+        {
+            logic.set_table(nullptr);
+            return;
+        }
+        const size_t size_mb = config("Cache", "HashMB");
+        cache = make_unique<Transposition_table>(0);    // Записи будут в файле
+        string error;
+        if (!cache->open(project_path + file, size_mb, logic.eval_version(), error))
+        {
+            Logger::instance().error("Position cache error: " + error);
+            cache = make_unique<Transposition_table>(size_mb);  // Файл занят процессом с другой оценкой — таблица только в памяти
+        }
+        logic.set_table(cache.get());
+        cache_flushed = chrono::steady_clock::now();
+    }
+
+    void flush_cache(const bool force)  // Сохраняет таблицу позиций на диск не чаще раза в Cache.FlushSeconds (force — сразу)
+    {
+        if (!cache)
+            return;
+        const auto now = chrono::steady_clock::now();
+        if (!force && now - cache_flushed < chrono::seconds(int(config("Cache", "FlushSeconds"))))
+            return;
+        cache->flush();
+        cache_flushed = now;
+    }
+
+    void open_database()    // Открывает хранилище партий Database.GamesFile на дозапись и индекс позиций Database.IndexFile
+    {
+        games.close();
+        database.close();
+        const string games_file = config("Database", "GamesFile");
+        if (games_file.empty())
+            return;
+        string error;
+        if (!games.open(project_path + games_file, Logic<Rules>::rules_version(), error))
+            Logger::instance().error("Game database error: " + error);
+        const string index_file = config("Database", "IndexFile");
+        if (!index_file.empty() && !database.open(project_path + index_file, project_path + games_file, Logic<Rules>::rules_version(), error))
+            Logger::instance().warning("Game database index is not loaded (run checkers --build-db): " + error);
+    }
+
+    bool restore_game(const Game_result result, game_record<Rules::Size> &game)  // Ходы законченной партии по истории доски
+    {
+        // Каждый прыжок серии — отдельное состояние истории, поэтому ход, состоящий из n прыжков, занимает n состояний
+        const auto &states = board.history_mtx;
+        game.result = result;
+        auto mtx = Logic<Rules>::to_mtx(states.front());
+        bool color = false;
+        for (size_t k = 0; k + 1 < states.size(); color = !color)
+        {
+            bool found = false;
+            for (const auto &turn : logic.legal_turns(mtx, color))
+            {
+                const auto next = logic.apply_turns(mtx, turn);
+                if (k + turn.size() < states.size() && Logic<Rules>::to_mtx(states[k + turn.size()]) == next)
+                {
+                    game.moves.push_back(game_move<Rules::Size>::make(turn));
+                    mtx = next;
+                    k += turn.size();
+                    found = true;
+                    break;
+                }
+            }
+            if (!found)
+            {
+                Logger::instance().error("Game error: can't restore the moves of the game", {{"state", k}});
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void annotate_game(const game_record<Rules::Size> &game)  // Разбор партии (Annotate) в Annotate.Output; таблица позиций — общая с ботом
+    {
+        TRACE_ZONE("game", "annotate_game");
+        Annotator<Rules> annotator(&config, cache.get());
+        annotator.write(annotator.annotate({game}, {0}));
+    }
+
+    void show_position_stats(const bool color)  // Статистика позиции на доске по базе партий — в заголовке окна
+    {
+        if (!database.is_open())
+            return;
+        const position_stats *stats = database.find(logic.history_key(Logic<Rules>::to_mtx(board.get_board()), color));
+        if (!stats)
+        {
+            board.set_title("Checkers - position not in the database");
+            return;
+        }
+        auto percent = [&](const uint32_t n) { return to_string((n * 100 + stats->games / 2) / stats->games) + "%"; };
+        board.set_title("Checkers - " + to_string(stats->games) + " games: white " + percent(stats->white) + ", draws " +
+                        percent(stats->draws) + ", black " + percent(stats->black));
+    }
+
+    bool solve_turn(const bool color, vector<move_pos> &turns, double &score)  // Ход решателя, если шашек не больше Solver.Pieces и позиция решена выигрышем или ничьей
+    {
+        if (!solver)
+            return false;
+        int pieces = 0;
+        for (const auto &row : board.get_board())
+            pieces += int(count_if(row.begin(), row.end(), [](const POS_T piece) { return piece != 0; }));
+        if (pieces > int(config("Solver", "Pieces")) || pieces == unsolved_pieces)
+            return false;
+        TRACE_ZONE("game", "solve_turn");
+        const solution res = solver->solve(Logic<Rules>::to_mtx(board.get_board()), color, logic.board_history(color));
+        const char *result = (res.result == Solve_result::WIN ? "win" : res.result == Solve_result::LOSS ? "loss" : res.result == Solve_result::DRAW ? "draw" : "unknown");
+        Logger::instance().info("Solver: " + string(result), {{"nodes", res.nodes}, {"time_ms", res.time_ms}, {"cached", res.cached}});
+        if (res.result == Solve_result::UNKNOWN)
+            unsolved_pieces = pieces;   // Не решилась в лимите узлов: до следующего взятия играем обычным поиском
+        if ((res.result != Solve_result::WIN && res.result != Solve_result::DRAW) || res.line.empty())
+            return false;   // При проигрыше обычный поиск выбирает ход, оттягивающий поражение
+        turns = res.line.front();
+        score = (res.result == Solve_result::WIN ? INF : DRAW_SCORE);
+        return true;
+    }
+
     void bot_turn(const bool color)   // Выполняет ход бота: вычисляет оптимальные ходы, применяет их с задержкой, логирует время
     {
+        TRACE_ZONE("game", "bot_turn");
         auto start = chrono::steady_clock::now();   // Измерение времени хода бота
 
         auto delay_ms = config("Bot", "BotDelayMS");   // Получение задержки из конфигурации
         // new thread for equal delay for each turn
         thread th(SDL_Delay, delay_ms);  // Поток для начальной задержки
-        auto turns = logic.find_best_turns(color);  // Получение оптимальных ходов от алгоритма
-        th.join();  // Ожидание завершения задержки
+        vector<move_pos> turns;
+        double score = 0;
+        if (!solve_turn(color, turns, score))   // В решённом эндшпиле — ход решателя, иначе — обычный поиск
+        {
+            turns = logic.find_best_turns(color);  // Получение оптимальных ходов от алгоритма
+            score = logic.last_stats().score;
+            flush_cache(false);
+        }
+        if (training.is_open() && !turns.empty())   // Позиция, оценка и лучший ход — в обучающие данные (результат — в конце партии)
+            training.add(training_record<Rules::Size>::make(board.get_board(), color, score, turns.front()));
+        {
+            TRACE_ZONE("game", "bot_delay");
+            th.join();  // Ожидание завершения задержки
+        }
         bool is_first = true;  // Флаг для корректной задержки между ходами
         // making moves
         for (auto turn : turns)  // Применение всех ходов из списка
@@ -123,17 +367,40 @@ class Game
             }
             is_first = false;  // Сброс флага после первого хода
             beat_series += (turn.xb != -1);  // Учёт битья в серии
-            board.move_piece(turn, beat_series);  // Выполнение хода
+            board.move_piece(turn, beat_series, logic.crowns(turn));  // Выполнение хода
+            if (turn.xb != -1)
+                logic.find_turns(turn.x2, turn.y2);  // Следующий прыжок серии (от него зависит превращение в дамку)
         }
 
         auto end = chrono::steady_clock::now();  // Окончание измерения времени
-        ofstream fout(project_path + "log.txt", ios_base::app);  // Логирование
-        fout << "Bot turn time: " << (int)chrono::duration<double, milli>(end - start).count() << " millisec\n";
-        fout.close();
+        int turn_ms = (int)chrono::duration<double, milli>(end - start).count();  // Логирование
+        Logger::instance().info("Bot turn time: " + to_string(turn_ms) + " millisec",
+                                {{"color", color ? "black" : "white"}, {"moves", turns.size()}});
+    }
+
+    void show_hints(const bool color)  // Подсказка игроку: лучшие Bot.Hints ходов (multi-PV) на глубине Bot.HintLevel + 1
+    {
+        const int hints_count = config("Bot", "Hints");
+        if (hints_count <= 0)
+            return;
+        TRACE_ZONE("game", "show_hints");
+        const int depth = logic.Max_depth;
+        logic.Max_depth = config("Bot", "HintLevel");
+        auto lines = logic.find_best_lines(color, hints_count);
+        logic.Max_depth = depth;
+        vector<vector<pair<POS_T, POS_T>>> paths;  // Клетки каждого хода: начало и клетка после каждого прыжка
+        for (const auto &line : lines)
+        {
+            paths.push_back({{line.turn.front().x, line.turn.front().y}});
+            for (const auto &turn : line.turn)
+                paths.back().emplace_back(turn.x2, turn.y2);
+        }
+        board.set_hints(paths);
     }
 
     Response player_turn(const bool color)  // Ход игрока: ожидает клика, валидирует ход, обрабатывает серию битья
     {
+        TRACE_ZONE("game", "player_turn");
         // return 1 if quit
         vector<pair<POS_T, POS_T>> cells;
         for (auto turn : logic.turns)  // Сбор координат возможных начальных клеток
@@ -141,6 +408,7 @@ class Game
             cells.emplace_back(turn.x, turn.y);
         }
         board.highlight_cells(cells);  // Подсветка возможных ходов
+        show_hints(color);  // Подсказка лучших ходов (если включена)
         move_pos pos = {-1, -1, -1, -1};  // Позиция выбранного хода
         POS_T x = -1, y = -1;  // Координаты начальной клетки
         // trying to make first move
@@ -148,7 +416,10 @@ class Game
         {
             auto resp = hand.get_cell();  // Ожидание клика по доске
             if (get<0>(resp) != Response::CELL)  // Обработка специальных команд (выход, повтор, откат)
+            {
+                board.clear_hints();
                 return get<0>(resp);
+            }
             pair<POS_T, POS_T> cell{get<1>(resp), get<2>(resp)};  // Полученные координаты
 
             bool is_correct = false;
@@ -195,12 +466,14 @@ class Game
         }
         board.clear_highlight();  // Очистка подсветки
         board.clear_active();  // Очистка подсветки
-        board.move_piece(pos, pos.xb != -1);  // Выполнение хода
-        if (pos.xb == -1)  // Простой ход без битья
+        board.clear_hints();  // Очистка подсказки
+        bool series_end = logic.ends_series(pos);  // Превращение в дамку может завершить серию (английские правила)
+        board.move_piece(pos, pos.xb != -1, logic.crowns(pos));  // Выполнение хода
+        if (pos.xb == -1 || series_end)  // Простой ход без битья
             return Response::OK;
         // continue beating while can
         beat_series = 1;  // Начало серии битья
-        while (true)  // Цикл продолжения серии битья
+        while (!series_end)  // Цикл продолжения серии битья
         {
             logic.find_turns(pos.x2, pos.y2);  // Поиск продолжения битья
             if (!logic.have_beats)  // Нет больше битья
@@ -237,7 +510,8 @@ class Game
                 board.clear_highlight();  // Очистка подсветки
                 board.clear_active();  // Сброс активной клетки
                 beat_series += 1;  // Увеличение счётчика серии
-                board.move_piece(pos, beat_series);  // Выполнение битья
+                series_end = logic.ends_series(pos);
+                board.move_piece(pos, beat_series, logic.crowns(pos));  // Выполнение битья
                 break;
             }
         }
@@ -249,7 +523,15 @@ class Game
     Config config;  // Объект конфигурации игры
     Board board;  // Объект доски
     Hand hand;  // Объект для обработки ввода
-    Logic logic;  // Объект логики игры
+    Logic<Rules> logic;  // Объект логики игры
+    Training_writer<Rules::Size> training;  // Запись позиций бота для обучения оценки
+    Solved_cache solved;  // Кэш решённых эндшпилей (Solver.CacheFile)
+    unique_ptr<Solver<Rules>> solver;  // Решатель эндшпилей (nullptr — выключен)
+    int unsolved_pieces = 0;  // Число шашек позиции, не решённой в лимите (до взятия решатель не вызывается)
+    unique_ptr<Transposition_table> cache;  // Постоянная таблица позиций бота (Cache.File; nullptr — выключена)
+    chrono::steady_clock::time_point cache_flushed;  // Время последнего сохранения таблицы на диск
+    Games_writer<Rules::Size> games;  // Хранилище сыгранных партий (Database.GamesFile)
+    Game_database<Rules::Size> database;  // Индекс позиций базы партий (Database.IndexFile; закрыт — статистика не показывается)
     int beat_series;  // Счётчик текущей серии битья
     bool is_replay = false;  // Флаг режима повтора игры
 };
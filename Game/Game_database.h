@@ -0,0 +1,378 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../Models/King_rays.h"
+#include "../Models/Move.h"
+#include "Mapped_file.h"
+#include "Training_data.h"
+
+// База партий: хранилище сыгранных партий и индекс позиций для запросов «в каких партиях встречалась позиция и чем они кончились».
+// Хранилище (games file): заголовок (magic "CKGS", версия, размер доски, хэш правил) и партии подряд. Партия — 4 байта
+// (результат, число ходов) и ходы по 3 байта: откуда, куда (номера тёмных клеток) и число взятых шашек, за которыми идут
+// номера их клеток. Ход серии взятий записан целиком, поэтому партию можно проверить и повторить генератором ходов.
+// Индекс (index file) строит checkers --build-db (Database_builder.h): заголовок, каталог по старшим 16 битам ключа,
+// статистика позиций, отсортированная по ключу Зобриста, ссылки «партия, полуход» на каждую позицию и смещения партий
+// в хранилище. Индекс отображается в память, поиск — каталог и двоичный поиск внутри его корзины.
+
+template <POS_T Size>
+struct game_move    // Ход партии целиком (серия взятий — один ход)
+{
+    typedef king_rays<Size> rays;
+
+    uint8_t from = 0;       // Начальная клетка (номер тёмной клетки)
+    uint8_t to = 0;         // Конечная клетка
+    uint64_t captured = 0;  // Взятые шашки (бит rays::square)
+
+    static game_move make(const std::vector<move_pos> &turns)   // Из списка прыжков (как в Logic::legal_turns)
+    {
+        game_move res;
+        res.from = uint8_t(rays::square(turns.front().x, turns.front().y));
+        res.to = uint8_t(rays::square(turns.back().x2, turns.back().y2));
+        for (const auto &turn : turns)
+            if (turn.xb != -1)
+                res.captured |= rays::bit(turn.xb, turn.yb);
+        return res;
+    }
+
+    bool matches(const std::vector<move_pos> &turns) const  // Тот же ход: начало, конец и взятые шашки (путь серии может отличаться)
+    {
+        const game_move other = make(turns);
+        return from == other.from && to == other.to && captured == other.captured;
+    }
+};
+
+template <POS_T Size>
+struct game_record
+{
+    Game_result result = Game_result::UNKNOWN;
+    std::vector<game_move<Size>> moves;
+};
+
+struct games_header
+{
+    char magic[4] = {'C', 'K', 'G', 'S'};
+    uint32_t version = 1;
+    uint32_t board_size = 0;
+    uint32_t reserved = 0;
+    uint64_t rules = 0; // Logic::rules_version (русские и бразильские шашки — обе 8x8)
+};
+
+struct game_header
+{
+    uint8_t result = 0;     // Game_result
+    uint8_t reserved = 0;
+    uint16_t moves = 0;     // Число ходов (полуходов)
+};
+
+// Дозапись партий в хранилище: партия кодируется в буфер и записывается одним блоком.
+template <POS_T Size>
+class Games_writer
+{
+  public:
+    ~Games_writer()
+    {
+        close();
+    }
+
+    bool open(const std::string &path, const uint64_t rules, std::string &error)   // Открывает хранилище на дозапись (создаёт, если файла нет)
+    {
+        close();
+        games_header header;
+        header.board_size = Size;
+        header.rules = rules;
+        file = std::fopen(path.c_str(), "ab+");
+        if (!file)
+        {
+            error = "can't open " + path;
+            return false;
+        }
+        std::fseek(file, 0, SEEK_END);
+        if (std::ftell(file) == 0)
+            std::fwrite(&header, sizeof(header), 1, file);
+        else
+        {
+            games_header existing;
+            std::fseek(file, 0, SEEK_SET);
+            if (std::fread(&existing, sizeof(existing), 1, file) != 1 || std::memcmp(&existing, &header, sizeof(header)) != 0)
+            {
+                error = path + " is a games file of other format or rules";
+                close();
+                return false;
+            }
+            std::fseek(file, 0, SEEK_END);
+        }
+        std::fflush(file);
+        return true;
+    }
+
+    bool is_open() const
+    {
+        return file != nullptr;
+    }
+
+    bool append(const game_record<Size> &game)
+    {
+        if (!file || game.moves.size() > UINT16_MAX)
+            return false;
+        game_header header;
+        header.result = uint8_t(game.result);
+        header.moves = uint16_t(game.moves.size());
+        buffer.assign(reinterpret_cast<const char *>(&header), reinterpret_cast<const char *>(&header) + sizeof(header));
+        for (const auto &move : game.moves)
+        {
+            buffer.push_back(char(move.from));
+            buffer.push_back(char(move.to));
+            const size_t count_at = buffer.size();
+            buffer.push_back(0);
+            for (uint64_t bits = move.captured; bits; bits &= bits - 1)
+            {
+                buffer.push_back(char(lowest_bit(bits)));
+                ++buffer[count_at];
+            }
+        }
+        const bool ok = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+        std::fflush(file);
+        return ok;
+    }
+
+    void close()
+    {
+        if (!file)
+            return;
+        std::fclose(file);
+        file = nullptr;
+    }
+
+  private:
+    std::FILE *file = nullptr;  // Хранилище партий
+    std::vector<char> buffer;   // Закодированная партия
+};
+
+// Чтение хранилища: файл отображается в память, партии разбираются по смещению.
+template <POS_T Size>
+class Games_reader
+{
+  public:
+    bool open(const std::string &path, const uint64_t rules, std::string &error)
+    {
+        games_header expected;
+        expected.board_size = Size;
+        expected.rules = rules;
+        if (!file.open(path, error))
+            return false;
+        if (file.size() < sizeof(games_header) || std::memcmp(file.data(), &expected, sizeof(expected)) != 0)
+        {
+            error = path + " is not a games file for these rules";
+            file.close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        file.close();
+    }
+
+    bool is_open() const
+    {
+        return file.data() != nullptr;
+    }
+
+    size_t size() const // Размер хранилища в байтах
+    {
+        return file.size();
+    }
+
+    static size_t begin()   // Смещение первой партии
+    {
+        return sizeof(games_header);
+    }
+
+    bool read(size_t &offset, game_record<Size> &game) const    // Партия по смещению offset (offset переходит к следующей); false — конец или испорченный хвост
+    {
+        const unsigned char *data = reinterpret_cast<const unsigned char *>(file.data());
+        size_t pos = offset;
+        if (pos + sizeof(game_header) > file.size())
+            return false;
+        game_header header;
+        std::memcpy(&header, data + pos, sizeof(header));
+        pos += sizeof(header);
+        if (header.result > uint8_t(Game_result::DRAW))
+            return false;
+        game.result = Game_result(header.result);
+        game.moves.resize(header.moves);
+        for (auto &move : game.moves)
+        {
+            if (pos + 3 > file.size())
+                return false;
+            move.from = data[pos];
+            move.to = data[pos + 1];
+            const size_t count = data[pos + 2];
+            pos += 3;
+            if (move.from >= rays::Squares || move.to >= rays::Squares || pos + count > file.size())
+                return false;
+            move.captured = 0;
+            for (size_t i = 0; i < count; ++i, ++pos)
+            {
+                if (data[pos] >= rays::Squares)
+                    return false;
+                move.captured |= uint64_t(1) << data[pos];
+            }
+        }
+        offset = pos;
+        return true;
+    }
+
+  private:
+    typedef king_rays<Size> rays;
+
+    Mapped_file file;   // Хранилище партий
+};
+
+struct index_header
+{
+    char magic[4] = {'C', 'K', 'G', 'I'};
+    uint32_t version = 1;
+    uint32_t board_size = 0;
+    uint32_t reserved = 0;
+    uint64_t rules = 0;
+    uint64_t positions = 0;     // Различных позиций
+    uint64_t refs = 0;          // Ссылок «партия, полуход»
+    uint64_t games = 0;         // Партий в индексе
+    uint64_t games_size = 0;    // Размер проиндексированной части хранилища
+};
+
+struct position_stats   // 32 байта
+{
+    uint64_t key = 0;       // Ключ позиции (Logic::history_key)
+    uint64_t first = 0;     // Первая ссылка на партию
+    uint32_t games = 0;     // Партий с этой позицией (повторение в партии считается один раз)
+    uint32_t white = 0;     // Из них выиграли белые
+    uint32_t black = 0;     // Выиграли чёрные
+    uint32_t draws = 0;     // Ничьи
+};
+
+struct game_ref
+{
+    uint32_t game = 0;      // Номер партии
+    uint16_t ply = 0;       // Полуход, на котором позиция встретилась впервые
+    uint16_t reserved = 0;
+};
+
+// Индекс позиций вместе с хранилищем партий; оба файла отображены в память, запросы не выделяют память.
+template <POS_T Size>
+class Game_database
+{
+  public:
+    static constexpr size_t Buckets = size_t(1) << 16;  // Корзины каталога (старшие 16 бит ключа)
+
+    bool open(const std::string &index_path, const std::string &games_path, const uint64_t rules, std::string &error)
+    {
+        close();
+        if (!store.open(games_path, rules, error) || !index.open(index_path, error))
+        {
+            close();
+            return false;
+        }
+        index_header expected;
+        expected.board_size = Size;
+        expected.rules = rules;
+        index_header header;
+        if (index.size() >= sizeof(header))
+            std::memcpy(&header, index.data(), sizeof(header));
+        if (index.size() < sizeof(header) || std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+            header.version != expected.version || header.board_size != expected.board_size || header.rules != expected.rules)
+        {
+            error = index_path + " is not a position index for these rules";
+            close();
+            return false;
+        }
+        if (index.size() != file_size(header) || header.games_size > store.size())
+        {
+            error = index_path + " is damaged or does not match " + games_path;
+            close();
+            return false;
+        }
+        const char *data = index.data() + sizeof(index_header);
+        directory = reinterpret_cast<const uint64_t *>(data);
+        data += (Buckets + 1) * sizeof(uint64_t);
+        stats = reinterpret_cast<const position_stats *>(data);
+        data += header.positions * sizeof(position_stats);
+        refs = reinterpret_cast<const game_ref *>(data);
+        data += header.refs * sizeof(game_ref);
+        offsets = reinterpret_cast<const uint64_t *>(data);
+        positions_count = header.positions;
+        games_count = header.games;
+        return true;
+    }
+
+    void close()
+    {
+        index.close();
+        store.close();
+        directory = offsets = nullptr;
+        stats = nullptr;
+        refs = nullptr;
+        positions_count = games_count = 0;
+    }
+
+    bool is_open() const
+    {
+        return directory != nullptr;
+    }
+
+    size_t positions() const
+    {
+        return positions_count;
+    }
+
+    size_t games() const
+    {
+        return games_count;
+    }
+
+    const position_stats *find(const uint64_t key) const    // Статистика позиции или nullptr, если позиции нет в базе
+    {
+        if (!directory)
+            return nullptr;
+        const position_stats *first = stats + directory[key >> 48];
+        const position_stats *last = stats + directory[(key >> 48) + 1];
+        const position_stats *it = std::lower_bound(first, last, key, [](const position_stats &p, const uint64_t k) { return p.key < k; });
+        return (it != last && it->key == key ? it : nullptr);
+    }
+
+    const game_ref *games_of(const position_stats &position) const  // Ссылки на партии позиции (position.games штук, по возрастанию номера партии)
+    {
+        return refs + position.first;
+    }
+
+    bool read_game(const uint32_t game, game_record<Size> &record) const
+    {
+        if (game >= games_count)
+            return false;
+        size_t offset = offsets[game];
+        return store.read(offset, record);
+    }
+
+    static size_t file_size(const index_header &header)
+    {
+        return sizeof(index_header) + (Buckets + 1) * sizeof(uint64_t) + header.positions * sizeof(position_stats) +
+               header.refs * sizeof(game_ref) + header.games * sizeof(uint64_t);
+    }
+
+  private:
+    Mapped_file index;  // Файл индекса
+    Games_reader<Size> store;   // Хранилище партий
+    const uint64_t *directory = nullptr;    // Начало каждой корзины в stats (Buckets + 1 значений)
+    const position_stats *stats = nullptr;  // Позиции по возрастанию ключа
+    const game_ref *refs = nullptr;     // Ссылки на партии
+    const uint64_t *offsets = nullptr;  // Смещения партий в хранилище
+    size_t positions_count = 0;
+    size_t games_count = 0;
+};
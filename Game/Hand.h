@@ -4,6 +4,8 @@
 #include "../Models/Move.h"
 #include "../Models/Response.h"
 #include "Board.h"
+#include "Input_log.h"
+#include "Trace.h"
 
 // methods for hands
 class Hand
@@ -14,13 +16,14 @@ class Hand
     }
     tuple<Response, POS_T, POS_T> get_cell() const  // Функция обработки ввода: возвращает ответ и координаты клика
     {
+        TRACE_ZONE("input", "get_cell");
         SDL_Event windowEvent;
         Response resp = Response::OK;   // Инициализация ответа по умолчанию
         int x = -1, y = -1; // Переменные для хранения координат мыши
         int xc = -1, yc = -1;   // Переменные для преобразованных координат клетки
         while (true)    // Бесконечный цикл обработки событий
         {
-            if (SDL_PollEvent(&windowEvent))    // Проверка событий SDL
+            if (poll(windowEvent))    // Проверка событий SDL (или записи ввода)
             {
                 switch (windowEvent.type)   // Обработка типа события
                 {
@@ -30,17 +33,17 @@ class Hand
                 case SDL_MOUSEBUTTONDOWN:   // Нажатие кнопки мыши
                     x = windowEvent.motion.x;
                     y = windowEvent.motion.y;
-                    xc = int(y / (board->H / 10) - 1);  // Преобразование Y-координаты в номер строки
-                    yc = int(x / (board->W / 10) - 1);  // Преобразование X-координаты в номер столбца
+                    xc = int(y / (board->H / (board->size + 2)) - 1);  // Преобразование Y-координаты в номер строки
+                    yc = int(x / (board->W / (board->size + 2)) - 1);  // Преобразование X-координаты в номер столбца
                     if (xc == -1 && yc == -1 && board->history_mtx.size() > 1)  // Клик на кнопку "назад"
                     {
                         resp = Response::BACK;
                     }
-                    else if (xc == -1 && yc == 8)   // Клик на кнопку "повтор"
+                    else if (xc == -1 && yc == board->size)   // Клик на кнопку "повтор"
                     {
                         resp = Response::REPLAY;
                     }
-                    else if (xc >= 0 && xc < 8 && yc >= 0 && yc < 8)    // Клик на игровую клетку
+                    else if (xc >= 0 && xc < board->size && yc >= 0 && yc < board->size)    // Клик на игровую клетку
                     {
                         resp = Response::CELL;
                     }
@@ -66,11 +69,12 @@ class Hand
 
     Response wait() const   // Функция ожидания действия игрока после конца игры
     {
+        TRACE_ZONE("input", "wait");
         SDL_Event windowEvent;
         Response resp = Response::OK;   // Инициализация ответа по умолчанию
         while (true)    // Бесконечный цикл обработки событий
         {
-            if (SDL_PollEvent(&windowEvent))    // Проверка событий SDL
+            if (poll(windowEvent))    // Проверка событий SDL (или записи ввода)
             {
                 switch (windowEvent.type)   // Обработка типа события
                 {
@@ -83,9 +87,9 @@ class Hand
                 case SDL_MOUSEBUTTONDOWN: { // Нажатие кнопки мыши
                     int x = windowEvent.motion.x;
                     int y = windowEvent.motion.y;
-                    int xc = int(y / (board->H / 10) - 1);  // Преобразование Y-координаты
-                    int yc = int(x / (board->W / 10) - 1);  // Преобразование X-координаты
-                    if (xc == -1 && yc == 8)    // Клик на кнопку "повтор"
+                    int xc = int(y / (board->H / (board->size + 2)) - 1);  // Преобразование Y-координаты
+                    int yc = int(x / (board->W / (board->size + 2)) - 1);  // Преобразование X-координаты
+                    if (xc == -1 && yc == board->size)    // Клик на кнопку "повтор"
                         resp = Response::REPLAY;
                 }
                 break;
@@ -97,6 +101,17 @@ class Hand
         return resp;    // Возврат ответа
     }
 
+    void set_input(Input_log *log)  // Ввод из записи (или с записью в файл); nullptr — напрямую из SDL
+    {
+        input = log;
+    }
+
   private:
+    bool poll(SDL_Event &e) const
+    {
+        return input ? input->poll(e, board->W, board->H) : SDL_PollEvent(&e);
+    }
+
     Board *board;   // Указатель на объект доски для взаимодействия
+    Input_log *input = nullptr; // Запись или воспроизведение ввода
 };
@@ -0,0 +1,223 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "Config.h"
+#include "Logger.h"
+
+// Запись и воспроизведение ввода (режимы checkers --record-input и checkers --replay-input) и замер отзывчивости интерфейса.
+// Hand берёт события через poll: при записи — из SDL с дозаписью в файл, при воспроизведении — из файла, без SDL,
+// поэтому партия повторяется точно так же (при Bot.NoRandom), в том числе под видеодрайвером SDL dummy без экрана.
+// Файл текстовый: строка заголовка "checkers-input 1 <ширина> <высота>", затем по событию в строке:
+//   <мс от начала> click <x> <y> | <мс> resize <ширина> <высота> | <мс> quit
+// Клики масштабируются к текущему размеру окна. Когда события кончаются, воспроизведение закрывает окно.
+// Замер: кадр — вызов Board::rerender (время отрисовки и показа, без задержки SDL_Delay), взаимодействие — от выдачи
+// события до следующего ожидания ввода (в него входит и ответный ход бота), задержка — от выдачи события до конца
+// первого SDL_RenderPresent после него.
+class Input_log
+{
+  public:
+    bool open(const string &path, const bool replay, string &error)  // Файл записи (replay = false) или воспроизведения
+    {
+        replaying = replay;
+        start = last_event = chrono::steady_clock::now();
+        if (!replay)
+        {
+            fout.open(path, ios_base::trunc);
+            if (!fout)
+            {
+                error = "can't open " + path;
+                return false;
+            }
+            return true;    // Заголовок пишется при первом опросе, когда размер окна уже известен
+        }
+        ifstream fin(path);
+        string magic;
+        int version = 0;
+        if (!(fin >> magic >> version >> recorded_w >> recorded_h) || magic != "checkers-input" || version != 1)
+        {
+            error = path + " is not an input log";
+            return false;
+        }
+        for (recorded_event e; fin >> e.time_ms >> e.kind;)
+        {
+            if (e.kind == "click" || e.kind == "resize")
+                fin >> e.x >> e.y;
+            else if (e.kind != "quit")
+            {
+                error = path + ": unknown event " + e.kind;
+                return false;
+            }
+            events.push_back(e);
+        }
+        return true;
+    }
+
+    void set_real_time(const bool value)   // Воспроизводить с паузами записи (иначе — без пауз)
+    {
+        real_time = value;
+    }
+
+    bool poll(SDL_Event &e, const int width, const int height)    // Следующее событие ввода (вместо SDL_PollEvent)
+    {
+        end_interaction();
+        if (!replaying)
+        {
+            if (!recorded_w && !recorded_h)
+            {
+                recorded_w = width;
+                recorded_h = height;
+                fout << "checkers-input 1 " << width << ' ' << height << '\n';
+            }
+            if (!SDL_PollEvent(&e))
+                return false;
+            if (record(e))  // Движение мыши и прочие события, на которые игра не отвечает, не записываются
+                begin_interaction();
+            return true;
+        }
+        if (next == events.size())  // Запись кончилась — закрываем окно
+        {
+            e = SDL_Event{};
+            e.type = SDL_QUIT;
+            begin_interaction();
+            return true;
+        }
+        const recorded_event &r = events[next];
+        const auto now = chrono::steady_clock::now();
+        if (real_time && next > 0 && now - last_event < chrono::milliseconds(r.time_ms - events[next - 1].time_ms))
+            return false;
+        ++next;
+        e = SDL_Event{};
+        if (r.kind == "click")
+        {
+            e.type = SDL_MOUSEBUTTONDOWN;
+            e.button.button = SDL_BUTTON_LEFT;
+            e.button.state = SDL_PRESSED;
+            e.button.x = recorded_w > 0 ? int(int64_t(r.x) * width / recorded_w) : r.x;
+            e.button.y = recorded_h > 0 ? int(int64_t(r.y) * height / recorded_h) : r.y;
+        }
+        else if (r.kind == "resize")
+        {
+            e.type = SDL_WINDOWEVENT;
+            e.window.event = SDL_WINDOWEVENT_SIZE_CHANGED;
+            e.window.data1 = recorded_w = r.x;
+            e.window.data2 = recorded_h = r.y;
+        }
+        else
+            e.type = SDL_QUIT;
+        last_event = now;
+        begin_interaction();
+        return true;
+    }
+
+    void frame(const double render_ms)  // Кадр показан (Board::rerender)
+    {
+        const auto now = chrono::steady_clock::now();
+        render_times.push_back(render_ms);
+        if (in_interaction)
+        {
+            ++interaction_frames;
+            if (interaction_frames == 1)
+                latencies.push_back(chrono::duration<double, milli>(now - event_time).count());
+        }
+    }
+
+    // Итог замера: JSON в path, запись в лог; false, если превышен порог (0 — без проверки)
+    bool report(const string &path, const double max_latency_ms, const double max_frames)
+    {
+        end_interaction();
+        const json stats = {{"frames", render_times.size()}, {"render_ms", percentiles(render_times)},
+                            {"interactions", interaction_sizes.size()}, {"frames_per_interaction", percentiles(interaction_sizes)},
+                            {"latency_ms", percentiles(latencies)}};
+        if (!path.empty())
+        {
+            ofstream out(path, ios_base::trunc);
+            out << stats.dump(4) << '\n';
+        }
+        Logger::instance().info("Input " + string(replaying ? "replay" : "record") + " stats: " + stats.dump());
+        cout << stats.dump(4) << endl;
+        bool ok = true;
+        if (max_latency_ms > 0 && !latencies.empty() && double(stats["latency_ms"]["p99"]) > max_latency_ms)
+        {
+            cout << "Input-to-present latency p99 is above " << max_latency_ms << " ms" << endl;
+            ok = false;
+        }
+        if (max_frames > 0 && !interaction_sizes.empty() && double(stats["frames_per_interaction"]["max"]) > max_frames)
+        {
+            cout << "Frames per interaction are above " << max_frames << endl;
+            ok = false;
+        }
+        return ok;
+    }
+
+  private:
+    struct recorded_event
+    {
+        int64_t time_ms = 0;    // От начала записи
+        string kind;            // click, resize или quit
+        int x = 0, y = 0;       // Координаты клика или размер окна
+    };
+
+    bool record(const SDL_Event &e)
+    {
+        const int64_t time_ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+        if (e.type == SDL_MOUSEBUTTONDOWN)
+            fout << time_ms << " click " << e.button.x << ' ' << e.button.y << '\n';
+        else if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+            fout << time_ms << " resize " << e.window.data1 << ' ' << e.window.data2 << '\n';
+        else if (e.type == SDL_QUIT)
+            fout << time_ms << " quit\n";
+        else
+            return false;
+        fout.flush();   // Запись не теряется, если игра упадёт
+        return true;
+    }
+
+    void begin_interaction()
+    {
+        in_interaction = true;
+        interaction_frames = 0;
+        event_time = chrono::steady_clock::now();
+    }
+
+    void end_interaction()  // Игра снова ждёт ввода
+    {
+        if (!in_interaction)
+            return;
+        in_interaction = false;
+        interaction_sizes.push_back(interaction_frames);
+    }
+
+    static json percentiles(vector<double> values)
+    {
+        if (values.empty())
+            return json::object();
+        sort(values.begin(), values.end());
+        auto at = [&](const double q) { return values[min(values.size() - 1, size_t(q * values.size()))]; };
+        auto round3 = [](const double v) { return round(v * 1000) / 1000; };    // До микросекунды
+        double sum = 0;
+        for (const double v : values)
+            sum += v;
+        return {{"mean", round3(sum / values.size())}, {"p50", round3(at(0.5))}, {"p90", round3(at(0.9))}, {"p99", round3(at(0.99))}, {"max", round3(values.back())}};
+    }
+
+    bool replaying = false;
+    bool real_time = false;
+    ofstream fout;  // Файл записи
+    vector<recorded_event> events;  // События воспроизведения
+    size_t next = 0;    // Следующее событие воспроизведения
+    int recorded_w = 0, recorded_h = 0; // Размер окна при записи (для масштабирования кликов)
+    chrono::steady_clock::time_point start;         // Начало записи
+    chrono::steady_clock::time_point last_event;    // Выдача предыдущего события (для воспроизведения с паузами)
+    chrono::steady_clock::time_point event_time;    // Выдача события текущего взаимодействия
+    bool in_interaction = false;
+    int interaction_frames = 0;
+    vector<double> render_times;    // Время отрисовки каждого кадра, мс
+    vector<double> interaction_sizes;   // Кадров на взаимодействие
+    vector<double> latencies;   // Задержка от события до показа, мс
+};
@@ -0,0 +1,371 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <initializer_list>
+#include <string>
+#include <thread>
+#include <type_traits>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "../Models/Log_level.h"
+
+struct log_field    // Структурированное поле записи лога: ключ=значение
+{
+    log_field(const char *key, const std::string &value) : key(key), value(value)
+    {
+    }
+    log_field(const char *key, const char *value) : key(key), value(value)
+    {
+    }
+    template <class T, class = std::enable_if_t<std::is_arithmetic_v<T>>>
+    log_field(const char *key, const T value) : key(key), value(std::to_string(value))
+    {
+    }
+
+    const char *key;
+    std::string value;
+};
+
+// Асинхронный логгер: производители (игровой поток, потоки поиска) кладут готовые строки в
+// ограниченное lock-free кольцо (очередь Вьюкова), фоновый поток пишет их в файл.
+// При переполнении запись отбрасывается, а не блокирует вызывающего.
+// При падении (сигнал) обработчик не трогает ofstream и кучу: он выбирает записи из кольца и пишет их вместе
+// со строкой о падении системным вызовом write в заранее открытый дескриптор того же файла.
+class Logger
+{
+  public:
+    static Logger &instance()   // Общий логгер приложения (log.txt), сбрасывается на диск при выходе из программы
+    {
+        static Logger logger;
+        return logger;
+    }
+
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    ~Logger()   // Останавливает фоновый поток и дописывает всё, что осталось в кольце
+    {
+        stop.store(true, std::memory_order_release);
+        if (writer.joinable())
+            writer.join();
+        close_crash_fd();
+    }
+
+    void open(const std::string &path, const bool truncate = true)   // Открывает файл лога (записи, сделанные до открытия, ждут в кольце)
+    {
+        lock_stream();
+        fout.close();
+        fout.open(path, truncate ? std::ios_base::trunc : std::ios_base::app);
+        close_crash_fd();
+#ifndef _WIN32
+        crash_fd.store(::open(path.c_str(), O_WRONLY | O_APPEND), std::memory_order_release);
+#else
+        crash_fd.store(_open(path.c_str(), _O_WRONLY | _O_APPEND), std::memory_order_release);
+#endif
+        unlock_stream();
+    }
+
+    void set_level(const Log_level new_level)   // Минимальный уровень записей, попадающих в лог
+    {
+        min_level.store(new_level, std::memory_order_relaxed);
+    }
+
+    bool enabled(const Log_level level) const   // Проверка уровня до форматирования сообщения
+    {
+        return level >= min_level.load(std::memory_order_relaxed);
+    }
+
+    static Log_level level_from_string(const std::string &name)   // "DEBUG"/"INFO"/"WARNING"/"ERROR" -> Log_level (по умолчанию INFO)
+    {
+        if (name == "DEBUG")
+            return Log_level::DEBUG;
+        if (name == "WARNING")
+            return Log_level::WARNING;
+        if (name == "ERROR")
+            return Log_level::ERROR;
+        return Log_level::INFO;
+    }
+
+    void log(const Log_level level, const std::string &text, std::initializer_list<log_field> fields = {})  // Неблокирующая запись в кольцо
+    {
+        if (!enabled(level))
+            return;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        slot *cell;
+        while (true)
+        {
+            cell = &ring[pos & (Capacity - 1)];
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0 && enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+            if (diff < 0)   // Кольцо заполнено: отбрасываем запись
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (diff > 0)
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+        cell->level = level;
+        cell->time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        size_t len = append(cell->text, 0, text.c_str());
+        for (const auto &field : fields)
+        {
+            len = append(cell->text, len, " ");
+            len = append(cell->text, len, field.key);
+            len = append(cell->text, len, "=");
+            len = append(cell->text, len, field.value.c_str());
+        }
+        cell->len = len;
+        cell->seq.store(pos + 1, std::memory_order_release);
+    }
+
+    void debug(const std::string &text, std::initializer_list<log_field> fields = {})
+    {
+        log(Log_level::DEBUG, text, fields);
+    }
+    void info(const std::string &text, std::initializer_list<log_field> fields = {})
+    {
+        log(Log_level::INFO, text, fields);
+    }
+    void warning(const std::string &text, std::initializer_list<log_field> fields = {})
+    {
+        log(Log_level::WARNING, text, fields);
+    }
+    void error(const std::string &text, std::initializer_list<log_field> fields = {})
+    {
+        log(Log_level::ERROR, text, fields);
+    }
+
+    void flush()    // Ждёт, пока фоновый поток запишет на диск всё, что было добавлено до вызова
+    {
+        if (!fout.is_open())
+            return;
+        const size_t target = enqueue_pos.load(std::memory_order_acquire);
+        while (flushed_pos.load(std::memory_order_acquire) < target && writer.joinable())
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    size_t dropped_count() const    // Количество записей, отброшенных из-за переполнения кольца
+    {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+  private:
+    static constexpr size_t Capacity = 1 << 12; // Размер кольца (степень двойки)
+    static constexpr size_t Text_size = 240;    // Максимальная длина одной записи
+    static constexpr size_t Prefix_size = 32;   // "[секунды.мс] УРОВЕНЬ " — как "[%10.3f] %-7s " (с запасом на 20 цифр)
+    static constexpr size_t Line_size = Prefix_size + Text_size + 1;    // Строка файла с переводом строки
+
+    struct slot
+    {
+        std::atomic<size_t> seq{0};
+        Log_level level = Log_level::INFO;
+        double time_ms = 0;
+        size_t len = 0;
+        char text[Text_size];
+    };
+
+    Logger() : start(std::chrono::steady_clock::now())
+    {
+        for (size_t i = 0; i < Capacity; ++i)
+            ring[i].seq.store(i, std::memory_order_relaxed);
+        writer = std::thread(&Logger::writer_loop, this);
+        std::signal(SIGSEGV, on_crash);
+        std::signal(SIGABRT, on_crash);
+        std::signal(SIGFPE, on_crash);
+        std::signal(SIGILL, on_crash);
+        std::set_terminate([] {
+            on_crash(SIGABRT);
+        });
+    }
+
+    static size_t append(char *buf, size_t len, const char *text)   // Дописывает строку в буфер записи с обрезкой по Text_size
+    {
+        const size_t n = std::min(std::strlen(text), Text_size - len);
+        std::memcpy(buf + len, text, n);
+        return len + n;
+    }
+
+    // Строка файла: префикс времени и уровня, текст и перевод строки. Без snprintf и выделения памяти — годится
+    // и для обработчика сигнала
+    static size_t format_line(char *line, const double time_ms, const Log_level level, const char *text, const size_t len)
+    {
+        static const char *const names[] = {"DEBUG  ", "INFO   ", "WARNING", "ERROR  "};
+        char digits[24];
+        size_t n = 0;
+        for (uint64_t ms = uint64_t(std::max(0.0, time_ms) + 0.5); n < 4 || ms > 0; ms /= 10)
+        {
+            if (n == 3)
+                digits[n++] = '.';
+            digits[n++] = char('0' + ms % 10);
+        }
+        size_t pos = 0;
+        line[pos++] = '[';
+        for (size_t pad = n; pad < 10; ++pad)
+            line[pos++] = ' ';
+        while (n > 0)
+            line[pos++] = digits[--n];
+        line[pos++] = ']';
+        line[pos++] = ' ';
+        std::memcpy(line + pos, names[int(level)], 7);
+        pos += 7;
+        line[pos++] = ' ';
+        std::memcpy(line + pos, text, len);
+        pos += len;
+        line[pos++] = '\n';
+        return pos;
+    }
+
+    bool pop_and_write()    // Извлекает одну запись из кольца и пишет её в файл; false, если кольцо пусто
+    {
+        char line[Line_size];
+        const size_t n = pop(line);
+        if (n == 0)
+            return false;
+        fout.write(line, n);
+        return true;
+    }
+
+    size_t pop(char *line)  // Извлекает одну запись из кольца в строку файла; 0, если кольцо пусто
+    {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        slot *cell;
+        while (true)
+        {
+            cell = &ring[pos & (Capacity - 1)];
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+            if (diff == 0 && dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+            if (diff < 0)
+                return 0;
+            if (diff > 0)
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+        }
+        const size_t n = format_line(line, cell->time_ms, cell->level, cell->text, cell->len);
+        cell->seq.store(pos + Capacity, std::memory_order_release);
+        return n;
+    }
+
+    void writer_loop()  // Фоновый поток: пишет записи пачками, сбрасывает файл, когда кольцо опустело
+    {
+        while (true)
+        {
+            const bool stopping = stop.load(std::memory_order_acquire);
+            lock_stream();
+            bool wrote = false;
+            while (fout.is_open() && pop_and_write())
+                wrote = true;
+            if (wrote)
+                fout.flush();
+            flushed_pos.store(dequeue_pos.load(std::memory_order_acquire), std::memory_order_release);
+            unlock_stream();
+            if (stopping)
+                break;
+            if (!wrote)
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+
+    // Аварийное завершение: дописываем то, что успели положить в кольцо, и строку о падении, и завершаемся.
+    // Только безопасные в обработчике сигнала действия: кольцо lock-free, строки собираются в стеке, запись — write
+    // в дескриптор файла лога (stderr, если лог не открыт); ofstream фонового потока не трогается
+    static void on_crash(const int sig)
+    {
+        Logger &logger = instance();
+        int fd = logger.crash_fd.load(std::memory_order_acquire);
+        if (fd < 0)
+            fd = 2;
+        char line[Line_size];
+        for (size_t n; (n = logger.pop(line)) != 0;)
+            raw_write(fd, line, n);
+        char text[32] = "Crash signal=";
+        size_t len = std::strlen(text);
+        char digits[12];
+        size_t count = 0;
+        for (unsigned value = unsigned(sig); count == 0 || value > 0; value /= 10)
+            digits[count++] = char('0' + value % 10);
+        while (count > 0)
+            text[len++] = digits[--count];
+        const double time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - logger.start).count();
+        raw_write(fd, line, format_line(line, time_ms, Log_level::ERROR, text, len));
+        std::signal(sig, SIG_DFL);
+#ifndef _WIN32
+        sigset_t unblock;   // Сигнал заблокирован на время своего обработчика — иначе raise не сработал бы до _Exit
+        sigemptyset(&unblock);
+        sigaddset(&unblock, sig);
+        sigprocmask(SIG_UNBLOCK, &unblock, nullptr);
+#endif
+        std::raise(sig);
+        std::_Exit(1);
+    }
+
+    static void raw_write(const int fd, const char *data, size_t size) // Системный write до конца буфера (без буферизации)
+    {
+        while (size > 0)
+        {
+#ifndef _WIN32
+            const ssize_t n = ::write(fd, data, size);
+#else
+            const int n = _write(fd, data, unsigned(size));
+#endif
+            if (n <= 0)
+                return;
+            data += n;
+            size -= size_t(n);
+        }
+    }
+
+    void close_crash_fd()
+    {
+        const int fd = crash_fd.exchange(-1, std::memory_order_acq_rel);
+        if (fd < 0)
+            return;
+#ifndef _WIN32
+        ::close(fd);
+#else
+        _close(fd);
+#endif
+    }
+
+    void lock_stream()
+    {
+        while (stream_busy.test_and_set(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+
+    void unlock_stream()
+    {
+        stream_busy.clear(std::memory_order_release);
+    }
+
+  private:
+    slot ring[Capacity];    // Кольцевой буфер записей
+    alignas(64) std::atomic<size_t> enqueue_pos{0}; // Позиция записи производителей
+    alignas(64) std::atomic<size_t> dequeue_pos{0}; // Позиция чтения фонового потока
+    std::atomic<size_t> flushed_pos{0}; // Позиция, до которой записи уже сброшены на диск
+    std::atomic<size_t> dropped{0}; // Счётчик отброшенных записей
+    std::atomic<Log_level> min_level{Log_level::INFO};  // Минимальный уровень записи
+    std::atomic<bool> stop{false};  // Флаг остановки фонового потока
+    std::atomic_flag stream_busy = ATOMIC_FLAG_INIT;    // Захват файла (фоновый поток или аварийный обработчик)
+    std::chrono::steady_clock::time_point start;  // Момент создания логгера (отсчёт времени записей)
+    std::ofstream fout; // Файл лога
+    std::atomic<int> crash_fd{-1};  // Дескриптор того же файла для аварийного обработчика (-1 — лог не открыт)
+    std::thread writer; // Фоновый поток записи
+};
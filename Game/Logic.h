@@ -1,152 +1,614 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
 #include <random>
 #include <vector>
 #include <cassert> // Для использования assert
+#include "../Models/Eval_weights.h"
+#include "../Models/Hash.h"
+#include "../Models/King_rays.h"
 #include "../Models/Move.h"
+#include "../Models/Move_list.h"
+#include "../Models/Move_series.h"
+#include "../Models/Pv_line.h"
+#include "../Models/Rules.h"
+#include "../Models/Search_stats.h"
 #include "Board.h"
 #include "Config.h"
+#include "Logger.h"
+#include "Nnue.h"
+#include "Trace.h"
+#include "Transposition_table.h"
 
 const int INF = 1e9;
+const double DRAW_SCORE = 1;    // Оценка ничьей (равное отношение стоимостей)
 
+inline void to_json(json& j, const search_stats& s)    // Сериализация статистики поиска в JSON (одна строка на ход бота)
+{
+    j = json{ {"color", s.color ? "black" : "white"}, {"depth", s.depth}, {"seldepth", s.seldepth},
+              {"nodes", s.nodes}, {"leaves", s.leaves}, {"score", s.score}, {"time_ms", s.time_ms}, {"nps", s.nps()},
+              {"beta_cutoffs", s.beta_cutoffs}, {"cutoff_rate", s.cutoff_rate()},
+              {"first_move_cutoff_rate", s.first_move_cutoff_rate()}, {"ebf", s.branching_factor()},
+              {"hash_probes", s.hash_probes}, {"hash_hits", s.hash_hits}, {"hash_hit_rate", s.hash_hit_rate()}, {"draws", s.draws} };
+    j["iterations"] = json::array();
+    for (const auto& it : s.iterations)
+        j["iterations"].push_back({ {"depth", it.depth}, {"nodes", it.nodes}, {"time_ms", it.time_ms} });
+}
+
+inline void to_json(json& j, const eval_weights& w)    // Файл весов оценки (Bot.EvalFile, пишется режимом --tune)
+{
+    j = json{ {"Scale", w.scale}, {"Man", w.man}, {"King", w.king} };
+}
+
+inline void from_json(const json& j, eval_weights& w)
+{
+    j.at("Scale").get_to(w.scale);
+    j.at("Man").get_to(w.man);
+    j.at("King").get_to(w.king);
+}
+
+template <class Rules>
 class Logic
 {
 public:
-    Logic(Board* board, Config* config) : board(board), config(config), Max_depth(5) // Значение по умолчанию
+    static constexpr POS_T Size = Rules::Size;  // Размер доски варианта
+    static constexpr size_t Max_pieces = Size * Size / 2;   // Ёмкость списка шашек одного цвета (число тёмных клеток)
+    static constexpr size_t Max_moves = 256;    // Ёмкость списка ходов одного узла поиска
+    static constexpr size_t Max_piece_moves = 2 * Size; // Ёмкость списка ходов одной шашки (дамка на пустых диагоналях)
+    static constexpr int Search_version = 1;    // Меняется, когда меняется смысл записей таблицы транспозиций (ключи, шкала оценок)
+
+    typedef std::array<std::array<POS_T, Size>, Size> board_mtx;  // Матрица доски для поиска (на стеке, без выделения памяти)
+    typedef move_series<Size> series;  // Ход поиска целиком (серия взятий — один ход)
+    typedef king_rays<Size> rays;  // Лучи дальнобойной дамки и нумерация тёмных клеток для масок
+
+    Logic(Board* board, Config* config) : board(board), config(config), Max_depth(5) // Значение по умолчанию (board может быть nullptr для анализа произвольных позиций)
     {
         rand_eng = std::default_random_engine(
             !((*config)("Bot", "NoRandom")) ? static_cast<unsigned>(time(0)) : 0);
         optimization = (*config)("Bot", "Optimization");
+        const std::string eval_file = (*config)("Bot", "EvalFile");
+        if (!eval_file.empty()) {   // Подобранные веса calc_score вместо весов по умолчанию
+            std::ifstream fin(project_path + eval_file);
+            const json data = json::parse(fin, nullptr, false);
+            eval_weights loaded;
+            try {
+                loaded = data.get<eval_weights>();
+            }
+            catch (const json::exception&) {    // Не JSON или нет нужных полей — останутся веса по умолчанию
+            }
+            if (loaded.man.size() == size_t(Max_pieces) && loaded.king.size() == size_t(Max_pieces))
+                weights = loaded;
+            else
+                Logger::instance().error("Error: can't load evaluation weights from " + project_path + eval_file +
+                                         ", using default weights");
+        }
+        const std::string nnue_file = (*config)("Bot", "NnueFile");
+        if (!nnue_file.empty()) {   // Нейросетевая оценка вместо материальной (если файл весов загрузился)
+            auto net = std::make_shared<Nnue<Size>>();
+            std::string error;
+            if (net->load(project_path + nnue_file, error))
+                nnue = net;
+            else
+                Logger::instance().error("Error: can't load NNUE weights, using material evaluation. " + error);
+        }
         // Можно добавить настройку Max_depth из config, если нужно:
         // if (config->contains("Bot", "MaxDepth")) Max_depth = (*config)("Bot", "MaxDepth");
     }
 
+    using stats_listener = std::function<void(const search_stats&)>;
+
+    void set_stats_listener(stats_listener listener)    // Подписка на статистику: вызывается после каждого поиска find_best_turns
+    {
+        on_stats = std::move(listener);
+    }
+
+    const search_stats& last_stats() const  // Статистика последнего поиска
+    {
+        return stats;
+    }
+
+    void set_table(Transposition_table* new_table)  // Подключает таблицу транспозиций (может быть общей для нескольких Logic)
+    {
+        table = new_table;
+    }
+
+    static uint64_t rules_version()  // Хэш правил варианта (варианты с одинаковым размером доски различаются)
+    {
+        const int rules[] = { Size, Rules::Men_capture_backward, Rules::Flying_kings, Rules::Majority_capture,
+                              int(Rules::Crowning_rule), Rules::King_moves_draw };
+        return hash_bytes(rules, sizeof(rules));
+    }
+
+    static board_mtx start_position()   // Начальная расстановка (как Board::make_start_mtx)
+    {
+        const POS_T rows = (Size - 2) / 2;
+        board_mtx mtx{};
+        for (POS_T i = 0; i < Size; ++i)
+            for (POS_T j = 0; j < Size; ++j)
+                if ((i + j) % 2 == 1)
+                    mtx[i][j] = (i < rows ? 2 : i >= Size - rows ? 1 : 0);
+        return mtx;
+    }
+
+    uint64_t eval_version() const   // Версия правил, оценки и формата поиска: оценки из файла таблицы другой версии не используются
+    {
+        const int rules[] = { Size, Rules::Men_capture_backward, Rules::Flying_kings, Rules::Majority_capture,
+                              int(Rules::Crowning_rule), Rules::King_moves_draw, Search_version };
+        uint64_t hash = hash_bytes(rules, sizeof(rules));
+        hash = hash_bytes(weights.man.data(), weights.man.size() * sizeof(double), hash);
+        hash = hash_bytes(weights.king.data(), weights.king.size() * sizeof(double), hash);
+        if (nnue) {
+            const uint64_t net = nnue->fingerprint();
+            hash = hash_bytes(&net, sizeof(net), hash);
+        }
+        return hash;
+    }
+
+    void set_limits(const std::atomic<bool>* stop_flag, const std::chrono::steady_clock::time_point stop_time = {})  // Внешний флаг отмены и крайний срок поиска
+    {
+        stop = stop_flag;
+        deadline = stop_time;
+    }
+
+    bool aborted() const    // Был ли последний поиск прерван флагом отмены или по времени (тогда результат неполный)
+    {
+        return stopped;
+    }
+
     std::vector<move_pos> find_best_turns(const bool color) {
-        next_move.clear();
-        next_best_state.clear();
+        set_history(board_history(color));
+        return find_best_turns(to_mtx(board->get_board()), color);
+    }
+
+    std::vector<move_pos> find_best_turns(const board_mtx& mtx, const bool color) { // Поиск лучшего хода в произвольной позиции
+        TRACE_ZONE_ARG("search", "find_best_turns", "depth", Max_depth + 1);
+        begin_search(mtx, color);
+        auto start = std::chrono::steady_clock::now();
+        series best;
+        best.x = -1;
+        end_search(find_first_best_turn(mtx, color, best), start);
+        return (best.x != -1 ? best.to_turns() : std::vector<move_pos>());  // Пустой, если ходов нет
+    }
 
-        find_first_best_turn(board->get_board(), color, -1, -1, 0);
+    std::vector<pv_line> find_best_lines(const bool color, const size_t lines_count) {
+        set_history(board_history(color));
+        return find_best_lines(to_mtx(board->get_board()), color, lines_count);
+    }
 
-        std::vector<move_pos> res;
-        int state = 0;
-        do {
-            if (static_cast<size_t>(state) < next_move.size() && static_cast<size_t>(state) < next_best_state.size()) {
-                res.push_back(next_move[state]);
-                state = next_best_state[state];
+    // Multi-PV: лучшие lines_count ходов с оценками за один проход дерева. Отсечение в корне идёт не по лучшему,
+    // а по lines_count-му результату, поэтому первые lines_count ходов получают точные оценки. Продолжения
+    // восстанавливаются по ходам из таблицы транспозиций (если она подключена), повторного поиска не требуется.
+    std::vector<pv_line> find_best_lines(const board_mtx& mtx, const bool color, const size_t lines_count) {
+        TRACE_ZONE_ARG("search", "find_best_lines", "depth", Max_depth + 1);
+        begin_search(mtx, color);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<pv_line> lines;
+        find_root_lines(mtx, color, lines, std::max<size_t>(lines_count, 1));
+        end_search(lines.empty() ? -1 : lines.front().score, start);
+        if (!stopped && table) {
+            for (auto& line : lines)
+                line.pv = principal_variation(apply_turns(mtx, line.turn), !color, color);
+        }
+        return lines;
+    }
+
+    bool crowns(const move_pos& turn) const // Станет ли шашка дамкой после хода (прыжка серии) turn на текущей доске
+    {
+        if (!promotes(board->get_board()[turn.x][turn.y], turn.x2))
+            return false;
+        if constexpr (Rules::Crowning_rule == Crowning::AT_END)
+            return !continues(turn);    // Простая шашка, которая бьёт дальше, проходит последний ряд не превращаясь
+        return true;
+    }
+
+    bool ends_series(const move_pos& turn) const    // Последний ли это прыжок серии битья (ходов find_turns)
+    {
+        return turn.xb != -1 && !continues(turn);
+    }
+
+    const eval_weights& get_weights() const // Веса оценки calc_score
+    {
+        return weights;
+    }
+
+    void set_seed(const unsigned seed)  // Переинициализация генератора случайных чисел (разные партии в параллельной самоигре)
+    {
+        rand_eng.seed(seed);
+    }
+
+    board_mtx apply_turns(board_mtx mtx, const std::vector<move_pos>& turns) const   // Применяет ход (всю серию из find_best_turns) к копии доски
+    {
+        if (turns.empty())
+            return mtx;
+        const move_pos& first = turns.front();
+        const move_pos& last = turns.back();
+        POS_T piece = mtx[first.x][first.y];
+        for (const auto& turn : turns) {
+            if (turn.xb != -1)
+                mtx[turn.xb][turn.yb] = 0;
+            if (Rules::Crowning_rule == Crowning::CONTINUE && promotes(piece, turn.x2))
+                piece += 2; // Дамкой можно стать и посреди серии
+        }
+        if (promotes(piece, last.x2))
+            piece += 2;
+        mtx[first.x][first.y] = 0;
+        mtx[last.x2][last.y2] = piece;
+        return mtx;
+    }
+
+    bool must_capture(const board_mtx& mtx, const bool color)   // Есть ли у стороны color обязательное взятие
+    {
+        return move_picker(this, mtx, color).have_beats();
+    }
+
+    // История партии для правил ничьей: ключи позиций (history_key) с последнего необратимого хода (хода простой
+    // шашкой или взятия), последний — позиция, которую будут искать. Поиск продолжает этот стек своими ходами и
+    // считает ничьей повторение позиции, а также серию ходов одними дамками длиной Rules::King_moves_draw.
+    // Если последний ключ не совпадает с позицией поиска, история не используется.
+    void set_history(std::vector<uint64_t> keys)
+    {
+        history = std::move(keys);
+    }
+
+    uint64_t history_key(const board_mtx& mtx, const bool color) const  // Ключ позиции с очередью хода (без цвета корня поиска)
+    {
+        return position_key(mtx, color, false);
+    }
+
+    static bool is_reversible(const board_mtx& mtx, const move_pos& turn)  // Обратимый ход: тихий ход дамки
+    {
+        return mtx[turn.x][turn.y] > 2 && turn.xb == -1;
+    }
+
+    static bool is_reversible(const board_mtx& mtx, const series& turn)
+    {
+        return mtx[turn.x][turn.y] > 2 && turn.hops == 0;
+    }
+
+    bool is_draw() const    // Ничья по правилам в конце истории set_history: троекратное повторение или лимит ходов дамками
+    {
+        return draw_by_rules(history, 0, history.size());
+    }
+
+    bool is_draw(const bool color)  // То же для позиции на доске (история берётся из истории доски)
+    {
+        set_history(board_history(color));
+        return is_draw();
+    }
+
+    std::vector<std::vector<move_pos>> legal_turns(const board_mtx& mtx, const bool color)  // Все ходы стороны целиком (списки прыжков; серии, дающие одну позицию, — один раз)
+    {
+        std::vector<std::vector<move_pos>> res;
+        move_picker picker(this, mtx, color);
+        series turn;
+        while (picker.next(turn))
+            res.push_back(turn.to_turns());
+        return res;
+    }
+
+    // Повторение позиции или лимит ходов одними дамками на стеке keys, где base — первая позиция после необратимого хода.
+    // Повторение позиции, встретившейся в поиске (индекс >= root), — ничья сразу: цикл можно повторять сколько угодно;
+    // повторение только позиций истории партии — при третьем появлении, как в правилах.
+    static bool draw_by_rules(const std::vector<uint64_t>& keys, const size_t base, const size_t root)
+    {
+        bool path_dependent;
+        return draw_by_rules(keys, base, root, path_dependent);
+    }
+
+    // То же; path_dependent — ничья зависит не только от поддерева узла: лимит ходов дамками (счётчик идёт от хода
+    // до узла) или повторение с участием позиций истории партии (индекс < root)
+    static bool draw_by_rules(const std::vector<uint64_t>& keys, const size_t base, const size_t root, bool& path_dependent)
+    {
+        const size_t last = keys.size() - 1;
+        path_dependent = true;
+        if (last - base >= 2 * static_cast<size_t>(Rules::King_moves_draw))
+            return true;
+        int repeats = 0;
+        for (size_t back = 4; back <= last - base; back += 2) {   // Та же очередь хода — через чётное число полуходов, не ближе 4
+            const size_t i = last - back;
+            if (keys[i] == keys[last] && (i >= root || ++repeats == 2)) {
+                path_dependent = (i < root);
+                return true;
             }
-            else {
-                break; // Выход при выходе за пределы
+        }
+        path_dependent = false;
+        return false;
+    }
+
+    std::vector<uint64_t> board_history(const bool color) const // Ключи позиций партии с последнего необратимого хода (по истории доски)
+    {
+        const auto& states = board->history_mtx;
+        if (states.empty())
+            return { history_key(to_mtx(board->get_board()), color) };
+        std::vector<uint64_t> keys;
+        bool side = color;
+        size_t i = states.size() - 1;
+        keys.push_back(history_key(to_mtx(states[i]), side));
+        for (; i > 0 && is_king_move(states[i - 1], states[i]); --i) {
+            side = !side;
+            keys.push_back(history_key(to_mtx(states[i - 1]), side));
+        }
+        std::reverse(keys.begin(), keys.end());
+        return keys;
+    }
+
+    static bool is_king_move(const std::vector<std::vector<POS_T>>& before, const std::vector<std::vector<POS_T>>& after) // Отличаются ли доски тихим ходом одной дамки
+    {
+        int changed = 0;
+        POS_T left = 0, arrived = 0;    // Шашка, ушедшая с клетки, и шашка, пришедшая на пустую клетку
+        for (POS_T i = 0; i < Size; ++i)
+            for (POS_T j = 0; j < Size; ++j) {
+                if (before[i][j] == after[i][j])
+                    continue;
+                if (++changed > 2)
+                    return false;
+                if (!after[i][j])
+                    left = before[i][j];
+                else if (!before[i][j])
+                    arrived = after[i][j];
+                else
+                    return false;
             }
-        } while (state != -1 && (static_cast<size_t>(state) < next_move.size() && next_move[state].x != -1));
-        return res;
+        return changed == 2 && left > 2 && left == arrived;
+    }
+
+private:
+    void begin_search(const board_mtx& mtx, const bool color)   // Сброс статистики и флага остановки перед новым поиском
+    {
+        stats = search_stats();
+        stats.color = color;
+        ply = 0;
+        stopped = false;
+        const uint64_t root_key = history_key(mtx, color);
+        if (!history.empty() && history.back() == root_key)
+            path = history;
+        else
+            path.assign(1, root_key);
+        path_base = 0;
+        path_root = path.size() - 1;
+        if (nnue) {
+            accumulators.resize(std::max<size_t>(accumulators.size(), 64));
+            nnue->refresh(mtx, accumulators[1]);  // Корень поиска выполняется на полуходе 1
+        }
+    }
+
+    void end_search(const double score, const std::chrono::steady_clock::time_point start)   // Итоги поиска и вызов подписчика статистики
+    {
+        stats.score = score;
+        stats.time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stats.depth = Max_depth + 1;
+        stats.iterations.push_back({ stats.depth, stats.nodes, stats.time_ms });
+        if (on_stats && !stopped)
+            on_stats(stats);
+    }
+
+    // Ключ Зобриста позиции (вместе с очередью хода и цветом, для которого считаются оценки)
+    uint64_t position_key(const board_mtx& mtx, const bool color, const bool root_color) const
+    {
+        uint64_t key = zobrist_key(Size * Size * 4) * color ^ zobrist_key(Size * Size * 4 + 1) * root_color;
+        for (POS_T i = 0; i < Size; ++i)
+            for (POS_T j = (i + 1) % 2; j < Size; j += 2)
+                if (mtx[i][j])
+                    key ^= zobrist_key((i * Size + j) * 4 + mtx[i][j] - 1);
+        return key;
+    }
+
+    bool out_of_time()  // Проверка флага отмены и крайнего срока (время — раз в 1024 узла)
+    {
+        if (stopped)
+            return true;
+        if (stop && stop->load(std::memory_order_relaxed))
+            stopped = true;
+        else if (deadline != std::chrono::steady_clock::time_point() && (stats.nodes & 1023) == 0 &&
+                 std::chrono::steady_clock::now() >= deadline)
+            stopped = true;
+        return stopped;
+    }
+
+public:
+    static board_mtx to_mtx(const std::vector<std::vector<POS_T>>& v)  // Перевод матрицы доски в массив фиксированного размера для поиска
+    {
+        assert(v.size() == size_t(Size) && !v.empty() && v[0].size() == size_t(Size) && "Invalid matrix size in to_mtx");
+        board_mtx mtx;
+        for (POS_T i = 0; i < Size; ++i)
+            for (POS_T j = 0; j < Size; ++j)
+                mtx[i][j] = v[i][j];
+        return mtx;
     }
 
 private:
-    std::vector<std::vector<POS_T>> make_turn(std::vector<std::vector<POS_T>> mtx, const move_pos& turn) const // Выполняет ход на копии матрицы
-    {
-        assert(mtx.size() == 8 && !mtx.empty() && mtx[0].size() == 8 && "Invalid matrix size in make_turn");
-        if (turn.xb != -1) {
-            assert(turn.xb < 8 && turn.yb < 8 && "Invalid beat position");
-            mtx[turn.xb][turn.yb] = 0;  // Удаление съеденной шашки
-        }
-        assert(turn.x < 8 && turn.y < 8 && turn.x2 < 8 && turn.y2 < 8 && "Invalid move position");
-        if ((mtx[turn.x][turn.y] == 1 && turn.x2 == 0) || (mtx[turn.x][turn.y] == 2 && turn.x2 == 7))
-            mtx[turn.x][turn.y] += 2;   // Преобразование шашки в дамку
-        mtx[turn.x2][turn.y2] = mtx[turn.x][turn.y];    // Перемещение шашки
-        mtx[turn.x][turn.y] = 0;    // Очистка начальной позиции
+    board_mtx make_turn(board_mtx mtx, const series& turn) const // Выполняет ход (всю серию) на копии матрицы
+    {
+        assert(turn.x < Size && turn.y < Size && turn.x2 < Size && turn.y2 < Size && "Invalid move position");
+        const POS_T piece = mtx[turn.x][turn.y];
+        for (int k = 0; k < turn.hops; ++k)
+            mtx[turn.hop[k].xb][turn.hop[k].yb] = 0;    // Съеденные шашки снимаются в конце хода
+        mtx[turn.x][turn.y] = 0;    // Очистка начальной позиции (до постановки: серия может закончиться там же)
+        mtx[turn.x2][turn.y2] = piece + (turn.crown ? 2 : 0);   // Перемещение шашки и превращение в дамку
         return mtx; // Возвращение обновлённой матрицы
     }
 
-    double calc_score(const std::vector<std::vector<POS_T>>& mtx, const bool first_bot_color) const   // Вычисляет оценку позиции
+    // Ход в поиске: копия доски плюс инкрементальное обновление аккумулятора сети для дочернего узла.
+    // Отмена хода бесплатна — аккумулятор родителя остаётся на своём полуходе нетронутым.
+    board_mtx play(const board_mtx& mtx, const series& turn) {
+        board_mtx next = make_turn(mtx, turn);
+        if (nnue) {
+            if (accumulators.size() <= ply + 1)
+                accumulators.resize(2 * accumulators.size());
+            nnue_accumulator& acc = accumulators[ply + 1];
+            acc = accumulators[ply];
+            nnue->remove(acc, turn.x, turn.y, mtx[turn.x][turn.y]);
+            nnue->add(acc, turn.x2, turn.y2, next[turn.x2][turn.y2]);
+            for (int k = 0; k < turn.hops; ++k)
+                nnue->remove(acc, turn.hop[k].xb, turn.hop[k].yb, mtx[turn.hop[k].xb][turn.hop[k].yb]);
+        }
+        return next;
+    }
+
+    double nnue_score(const nnue_accumulator& acc, const bool first_bot_color) const   // Оценка сетью в той же шкале, что и calc_score
+    {
+        if (acc.pieces[first_bot_color ? 0 : 1] == 0)  // Все шашки соперника съедены
+            return INF;
+        if (acc.pieces[first_bot_color ? 1 : 0] == 0)
+            return 0;
+        const double logit = nnue->evaluate(acc);   // >0 — лучше белым
+        return std::exp(std::clamp(first_bot_color ? -logit : logit, -20.0, 20.0));   // Шансы выигрыша (отношение, как у материала)
+    }
+
+    static bool promotes(const POS_T piece, const POS_T row)  // Доходит ли простая шашка piece до последнего для неё ряда row
     {
-        assert(mtx.size() == 8 && !mtx.empty() && mtx[0].size() == 8 && "Invalid matrix size in calc_score");
-        double w = 0, wq = 0, b = 0, bq = 0;    // Счётчики для белых шашек, дамок, чёрных шашек и дамок
-        for (POS_T i = 0; i < 8; ++i) {
-            for (POS_T j = 0; j < 8; ++j) {
+        return (piece == 1 && row == 0) || (piece == 2 && row == Size - 1);
+    }
+
+    bool continues(const move_pos& turn) const  // Продолжается ли после прыжка turn хотя бы одна серия битья из find_turns
+    {
+        for (const auto& s : legal)
+            if (s.hops > hop_index + 1 && s.hop[hop_index].x2 == turn.x2 && s.hop[hop_index].y2 == turn.y2 &&
+                s.hop[hop_index].xb == turn.xb && s.hop[hop_index].yb == turn.yb)
+                return true;
+        return false;
+    }
+
+    double calc_score(const board_mtx& mtx, const bool first_bot_color) const   // Вычисляет оценку позиции
+    {
+        double w = 0, b = 0;    // Суммарная стоимость белых и чёрных шашек (веса из eval_weights)
+        int wn = 0, bn = 0;     // Количество белых и чёрных шашек
+        for (POS_T i = 0; i < Size; ++i) {
+            for (POS_T j = 0; j < Size; ++j) {
                 assert(mtx[i][j] >= 0 && mtx[i][j] <= 4 && "Invalid piece value");
-                w += (mtx[i][j] == 1);  // Подсчёт белых шашек
-                wq += (mtx[i][j] == 3); // Подсчёт белых дамок
-                b += (mtx[i][j] == 2);  // Подсчёт чёрных шашек
-                bq += (mtx[i][j] == 4); // Подсчёт чёрных дамок
+                if (!mtx[i][j])
+                    continue;
+                const double value = (mtx[i][j] <= 2 ? weights.man : weights.king)[eval_weights::square(i, j, mtx[i][j], Size)];
+                if (mtx[i][j] % 2) {    // Белая шашка или дамка
+                    w += value;
+                    ++wn;
+                }
+                else {
+                    b += value;
+                    ++bn;
+                }
             }
         }
         if (!first_bot_color) {   // Инверсия значений для игрока другого цвета
             std::swap(b, w);
-            std::swap(bq, wq);
+            std::swap(bn, wn);
         }
-        if (w + wq == 0)    // Победа чёрных (все белые съедены)
+        if (wn == 0)    // Победа чёрных (все белые съедены)
             return INF;
-        if (b + bq == 0)    // Победа белых (все чёрные съедены)
+        if (bn == 0)    // Победа белых (все чёрные съедены)
             return 0;
-        int q_coef = 4; // Коэффициент для дамок
-        return (b + bq * q_coef) / (w + wq * q_coef);   // Нормализованная оценка
+        return b / w;   // Нормализованная оценка
     }
 
-    double find_first_best_turn(std::vector<std::vector<POS_T>> mtx, const bool color, const POS_T x, const POS_T y, size_t state,
-        double alpha = -1) {
-        assert(mtx.size() == 8 && !mtx.empty() && mtx[0].size() == 8 && "Invalid matrix size in find_first_best_turn");
-        next_move.emplace_back(-1, -1, -1, -1);
-        next_best_state.push_back(-1);
-        if (state != 0) {
-            find_turns(x, y, mtx);
-        }
-        auto now_turns = turns;
-        auto now_have_beats = have_beats;
-        if (!now_have_beats && state != 0) {
-            return find_best_turns_rec(mtx, 1 - color, 0, alpha);
-        }
+    double find_first_best_turn(const board_mtx& mtx, const bool color, series& best) {   // Корень поиска: лучший ход целиком
+        ply_guard guard(this);
+        move_picker picker(this, mtx, color);
         double best_score = -1;
-        for (auto& turn : now_turns) {
-            size_t new_state = next_move.size();
-            double score;
-            if (now_have_beats) {
-                score = find_first_best_turn(make_turn(mtx, turn), color, turn.x2, turn.y2, new_state, best_score);
-            }
-            else {
-                score = find_best_turns_rec(make_turn(mtx, turn), 1 - color, 0, best_score);
-            }
+        series turn;
+        while (picker.next(turn)) {
+            path_guard step(this, mtx, turn);
+            const double score = find_best_turns_rec(play(mtx, turn), 1 - color, 0, best_score);
             if (score > best_score) {
                 best_score = score;
-                if (state < next_move.size()) {
-                    next_move[state] = turn;
-                    next_best_state[state] = (now_have_beats ? static_cast<int>(new_state) : -1);
-                }
+                best = turn;
             }
         }
         return best_score;
     }
 
-    double find_best_turns_rec(std::vector<std::vector<POS_T>> mtx, const bool color, const size_t depth, double alpha = -1,
-        double beta = INF + 1, const POS_T x = -1, const POS_T y = -1) {
-        assert(mtx.size() == 8 && !mtx.empty() && mtx[0].size() == 8 && "Invalid matrix size in find_best_turns_rec");
-        if (depth == Max_depth) {
-            return calc_score(mtx, (depth % 2 == color));
+    void find_root_lines(const board_mtx& mtx, const bool color, std::vector<pv_line>& lines,
+        const size_t lines_count) {  // Корень multi-PV: каждый ход ищется с альфой по худшему из лучших lines_count
+        ply_guard guard(this);
+        move_picker picker(this, mtx, color);
+        series turn;
+        while (picker.next(turn)) {
+            path_guard step(this, mtx, turn);
+            const double alpha = (lines.size() < lines_count ? -1 : lines.back().score);
+            add_line(find_best_turns_rec(play(mtx, turn), 1 - color, 0, alpha), turn.to_turns(), lines, lines_count);
         }
-        if (x != -1) {
-            find_turns(x, y, mtx);
+    }
+
+    static void add_line(const double score, const std::vector<move_pos>& turn, std::vector<pv_line>& lines,
+        const size_t lines_count) {   // Вставка хода в отсортированный по убыванию оценки список лучших lines_count
+        if (lines.size() == lines_count && score <= lines.back().score)
+            return; // Оценка не выше альфы — это лишь верхняя граница, ход в список не попадает
+        auto it = std::find_if(lines.begin(), lines.end(), [score](const pv_line& line) { return line.score < score; });
+        lines.insert(it, pv_line{ score, turn, {} });
+        if (lines.size() > lines_count)
+            lines.pop_back();
+    }
+
+    std::vector<move_pos> principal_variation(board_mtx mtx, bool color, const bool root_color) {  // Продолжение по лучшим ходам из таблицы транспозиций
+        std::vector<move_pos> pv;
+        for (int plies = 0; plies < Max_depth; ++plies) {
+            move_picker picker(this, mtx, color);
+            tt_entry entry;
+            series turn;
+            if (!table->probe(position_key(mtx, color, root_color), entry) || !picker.find(entry.move, turn))
+                break;  // Нет записи или ход из неё недопустим (ячейку заняла другая позиция)
+            const auto hops = turn.to_turns();
+            pv.insert(pv.end(), hops.begin(), hops.end());
+            mtx = make_turn(mtx, turn);
+            color = !color;
         }
-        else {
-            find_turns(color, mtx);
+        return pv;
+    }
+
+    double find_best_turns_rec(board_mtx mtx, const bool color, const size_t depth, double alpha = -1,
+        double beta = INF + 1) {
+        ply_guard guard(this);
+        if (out_of_time()) {
+            return 0;
+        }
+        bool path_dependent = false;
+        if (path.size() - path_base > 4 && draw_by_rules(path, path_base, path_root, path_dependent)) {   // Повторение или лимит ходов дамками: цикл дальше не ищется
+            ++stats.draws;
+            path_draw = path_draw || path_dependent;
+            return DRAW_SCORE;
         }
-        auto now_turns = turns;
-        auto now_have_beats = have_beats;
-        if (!now_have_beats && x != -1) {
-            return find_best_turns_rec(mtx, 1 - color, depth + 1, alpha, beta);
+        if (depth == Max_depth) {
+            ++stats.leaves;
+            return (nnue ? nnue_score(accumulators[ply], (depth % 2 == color)) : calc_score(mtx, (depth % 2 == color)));
         }
 
-        if (turns.empty()) {
-            return (depth % 2 ? 0 : INF);
+        // Таблица транспозиций: отсечение по сохранённой оценке и ход для упорядочивания
+        const double alpha0 = alpha, beta0 = beta;
+        const int depth_left = Max_depth - static_cast<int>(depth);
+        uint64_t key = 0;
+        move_pos hash_move;
+        if (table) {
+            key = position_key(mtx, color, (depth % 2 ? color : !color));
+            ++stats.hash_probes;
+            tt_entry entry;
+            if (table->probe(key, entry)) {
+                ++stats.hash_hits;
+                hash_move = entry.move;
+                if (entry.depth >= depth_left && (entry.bound == Bound::EXACT ||
+                    (entry.bound == Bound::LOWER && entry.score >= beta) || (entry.bound == Bound::UPPER && entry.score <= alpha))) {
+                    return entry.score;
+                }
+            }
         }
 
+        const bool outer_draw = path_draw;  // Флаг вызывающего узла; поддерево этого узла отмечается отдельно
+        path_draw = false;
+        move_picker picker(this, mtx, color, hash_move);
         double min_score = INF + 1;
         double max_score = -1;
-        for (auto& turn : now_turns) {
-            double score;
-            if (now_have_beats) {
-                score = find_best_turns_rec(make_turn(mtx, turn), color, depth, alpha, beta, turn.x2, turn.y2);
-            }
-            else {
-                score = find_best_turns_rec(make_turn(mtx, turn), 1 - color, depth + 1, alpha, beta);
-            }
+        series turn;
+        move_pos best_turn;
+        size_t i = 0;
+        for (; picker.next(turn); ++i) {
+            stats.interior += (i == 0);
+            path_guard step(this, mtx, turn);
+            const double score = find_best_turns_rec(play(mtx, turn), 1 - color, depth + 1, alpha, beta);
+            if (depth % 2 ? score > max_score : score < min_score)
+                best_turn = turn.key();
             min_score = std::min(min_score, score);
             max_score = std::max(max_score, score);
             // Альфа-бета обрезка
@@ -157,127 +619,451 @@ private:
                 beta = std::min(beta, min_score);
             }
             if (optimization != "O0" && alpha >= beta) {
-                return (depth % 2 ? max_score : min_score);
+                ++stats.beta_cutoffs;
+                stats.first_move_cutoffs += (i == 0);
+                break;
             }
         }
-        return (depth % 2 ? max_score : min_score);
+        if (min_score > INF) {   // Нет ходов (оценка любого хода не больше INF) — проигрыш стороны, которая должна ходить
+            path_draw = outer_draw;
+            return (depth % 2 ? 0 : INF);
+        }
+        const double score = (depth % 2 ? max_score : min_score);
+        const bool subtree_draw = path_draw;
+        path_draw = outer_draw || subtree_draw;
+        // Оценка, в которую вошла ничья из-за истории партии или лимита ходов дамками, верна только для этого пути:
+        // ключ таблицы — позиция без истории, а таблица (Cache.File) переживает партию и общая для процессов
+        if (table && !stopped && !subtree_draw) {
+            tt_entry entry;
+            entry.score = score;
+            entry.depth = depth_left;
+            entry.bound = (score <= alpha0 ? Bound::UPPER : score >= beta0 ? Bound::LOWER : Bound::EXACT);
+            entry.move = best_turn;
+            table->store(key, entry);
+        }
+        return score;
     }
 
 public:
-    void find_turns(const bool color)   // Инициализирует поиск всех ходов для указанного цвета
+    void find_turns(const bool color)   // Инициализирует поиск всех ходов для указанного цвета (серии битья — все пути, turns — первые прыжки)
     {
-        find_turns(color, board->get_board());
+        const board_mtx mtx = to_mtx(board->get_board());
+        const uint64_t occupied = occupancy(mtx);
+        legal.clear();
+        hop_index = 0;
+        turns.clear();
+        for (POS_T i = 0; i < Size; ++i)
+            for (POS_T j = 0; j < Size; ++j)
+                if (mtx[i][j] && mtx[i][j] % 2 != color)
+                    find_series(mtx, occupied, i, j, legal);
+        keep_majority(legal);
+        have_beats = !legal.empty();
+        if (have_beats)
+            collect_hops();
+        else {  // Тихие ходы допустимы, только если ни одна шашка не может бить
+            for (POS_T i = 0; i < Size; ++i)
+                for (POS_T j = 0; j < Size; ++j)
+                    if (mtx[i][j] && mtx[i][j] % 2 != color)
+                        find_quiets(mtx, occupied, i, j, turns);
+        }
+        if (!turns.empty()) {
+            std::shuffle(turns.begin(), turns.end(), rand_eng);
+        }
     }
 
-    void find_turns(const POS_T x, const POS_T y)   // Инициализирует поиск ходов для шашки на позиции (x, y)
+    void find_turns(const POS_T x, const POS_T y)   // Продолжение серии битья после прыжка на (x, y): следующие прыжки серий find_turns
     {
-        find_turns(x, y, board->get_board());
+        legal.erase(std::remove_if(legal.begin(), legal.end(), [&](const series& s) {
+            return s.hops <= hop_index || s.hop[hop_index].x2 != x || s.hop[hop_index].y2 != y;
+        }), legal.end());
+        ++hop_index;
+        turns.clear();
+        collect_hops();
+        have_beats = !turns.empty();
     }
 
 private:
-    void find_turns(const bool color, const std::vector<std::vector<POS_T>>& mtx) // Ищет все возможные ходы для указанного цвета
-    {
-        assert(mtx.size() == 8 && !mtx.empty() && mtx[0].size() == 8 && "Invalid matrix size in find_turns");
-        std::vector<move_pos> res_turns;
-        bool have_beats_before = false;
-        for (POS_T i = 0; i < 8; ++i) {
-            for (POS_T j = 0; j < 8; ++j) {
-                if (mtx[i][j] && mtx[i][j] % 2 != color) {
-                    find_turns(i, j, mtx);
-                    if (have_beats && !have_beats_before) {
-                        have_beats_before = true;
-                        res_turns.clear();
-                    }
-                    if ((have_beats_before && have_beats) || !have_beats_before) {
-                        res_turns.insert(res_turns.end(), turns.begin(), turns.end());
-                    }
+    void collect_hops()  // turns — различные прыжки номер hop_index ещё возможных серий
+    {
+        for (const auto& s : legal) {
+            if (s.hops <= hop_index)
+                continue;
+            const hop_pos& h = s.hop[hop_index];
+            const move_pos turn(hop_index ? s.hop[hop_index - 1].x2 : s.x, hop_index ? s.hop[hop_index - 1].y2 : s.y, h.x2, h.y2, h.xb, h.yb);
+            if (std::none_of(turns.begin(), turns.end(), [&](const move_pos& t) { return t == turn && t.xb == turn.xb && t.yb == turn.yb; }))
+                turns.push_back(turn);
+        }
+    }
+
+    static bool inside(const POS_T i, const POS_T j)
+    {
+        return i >= 0 && i < Size && j >= 0 && j < Size;
+    }
+
+    static uint64_t occupancy(const board_mtx& mtx)  // Маска занятых клеток (бит rays::square)
+    {
+        uint64_t res = 0;
+        for (POS_T i = 0; i < Size; ++i)
+            for (POS_T j = (i + 1) % 2; j < Size; j += 2)
+                if (mtx[i][j])
+                    res |= rays::bit(i, j);
+        return res;
+    }
+
+    // Все серии взятий шашки на (x, y), каждая доведена до конца (прервать серию нельзя). Съеденные шашки снимаются
+    // только в конце хода: через них нельзя перепрыгнуть второй раз и нельзя пройти дальше (правило турецкого удара).
+    // Пустота клеток проверяется по маске occupied, цвет шашки — по mtx
+    template <class List>
+    void find_series(const board_mtx& mtx, const uint64_t occupied, const POS_T x, const POS_T y, List& out) const
+    {
+        series s;
+        s.x = x;
+        s.y = y;
+        s.hops = 0;
+        s.crown = false;
+        s.captured = 0;
+        // Шашка ушла с начальной клетки: серия может пройти через неё или закончиться на ней
+        extend_series(mtx, occupied & ~rays::bit(x, y), x, y, mtx[x][y], s, out);
+    }
+
+    template <class List>
+    void extend_series(const board_mtx& mtx, const uint64_t occupied, const POS_T x, const POS_T y, const POS_T type, series& s,
+        List& out) const {  // Продолжения серии s шашкой type с (x, y)
+        bool extended = false;
+        for (int d = 0; d < rays::Directions; ++d) {
+            const POS_T i = rays::Di[d], j = rays::Dj[d];
+            if (!Rules::Men_capture_backward && type <= 2 && (type == 1) != (i < 0)) continue;  // Простые бьют только вперёд
+            if (type > 2 && Rules::Flying_kings) {  // Дальнобойная дамка: ближайшая шашка на луче и свободные поля за ней
+                const int target = rays::nearest(rays::square(x, y), d, occupied);
+                if (target < 0)
+                    continue;
+                const POS_T xb = rays::row(target), yb = rays::col(target);
+                if (mtx[xb][yb] % 2 == type % 2 || (s.captured & rays::bit(xb, yb)))
+                    continue;   // Своя шашка или уже съеденная в этой серии
+                for (uint64_t land = rays::free_squares(target, d, occupied); land;) {
+                    const int to = rays::pop_nearest(land, d);
+                    extended = true;
+                    add_hop(mtx, occupied, rays::row(to), rays::col(to), xb, yb, type, s, out);
                 }
+                continue;
             }
+            const POS_T xb = x + i, yb = y + j, x2 = xb + i, y2 = yb + j;  // Простая шашка и недальнобойная дамка встают сразу за съеденной
+            if (!inside(x2, y2) || (occupied & rays::bit(x2, y2)) || !(occupied & rays::bit(xb, yb)) ||
+                mtx[xb][yb] % 2 == type % 2 || (s.captured & rays::bit(xb, yb)))
+                continue;   // Некуда встать, не шашка соперника или уже съеденная в этой серии
+            extended = true;
+            add_hop(mtx, occupied, x2, y2, xb, yb, type, s, out);
         }
-        turns = res_turns;
-        if (!turns.empty()) {
-            std::shuffle(turns.begin(), turns.end(), rand_eng);
+        if (!extended && s.hops) {  // Бить дальше нечем — серия закончена
+            const bool crown = s.crown;
+            s.x2 = x;
+            s.y2 = y;
+            if (Rules::Crowning_rule == Crowning::AT_END && promotes(type, x))
+                s.crown = true;
+            out.push_back(s);
+            s.crown = crown;
+        }
+    }
+
+    template <class List>
+    void add_hop(const board_mtx& mtx, const uint64_t occupied, const POS_T x, const POS_T y, const POS_T xb, const POS_T yb,
+        const POS_T type, series& s, List& out) const {  // Прыжок на (x, y) со взятием шашки на (xb, yb) и продолжение серии
+        if (s.hops == series::Max_hops)  // Соперник с шашками сверх начального числа (позиция не из партии): серия не продолжается
+            return;
+        s.hop[s.hops++] = hop_pos{ x, y, xb, yb };
+        s.captured |= series::bit(xb, yb);
+        const bool crown = s.crown;
+        if (Rules::Crowning_rule != Crowning::AT_END && promotes(type, x)) {
+            s.crown = true;
+            if constexpr (Rules::Crowning_rule == Crowning::STOP) {  // Превращение в дамку завершает ход
+                s.x2 = x;
+                s.y2 = y;
+                out.push_back(s);
+            }
+            else
+                extend_series(mtx, occupied, x, y, type + 2, s, out);  // Дальше бьёт уже дамкой
         }
-        have_beats = have_beats_before;
+        else
+            extend_series(mtx, occupied, x, y, type, s, out);
+        s.crown = crown;
+        s.captured &= ~series::bit(xb, yb);
+        --s.hops;
     }
 
-    void find_turns(const POS_T x, const POS_T y, const std::vector<std::vector<POS_T>>& mtx) // Ищет возможные ходы для конкретной шашки
+    static void report_overflow(const size_t dropped)   // Переполнение списка взятий узла (пишется в лог один раз за запуск)
+    {
+        static std::atomic<bool> reported{false};
+        if (!reported.exchange(true))
+            Logger::instance().warning("Move list overflow: capture series dropped", {{"dropped", dropped}, {"capacity", Max_moves}});
+    }
+
+    template <class List>
+    void keep_majority(List& moves) const    // Правило большинства: оставляет только серии, съедающие больше всего шашек
+    {
+        if constexpr (Rules::Majority_capture) {
+            int best = 0;
+            for (const auto& turn : moves)
+                best = std::max(best, int(turn.hops));
+            size_t kept = 0;
+            for (size_t i = 0; i < moves.size(); ++i)
+                if (moves[i].hops == best)
+                    moves[kept++] = moves[i];
+            moves.resize(kept);
+        }
+    }
+
+    // Список серий для поиска: серии, отличающиеся только порядком прыжков, — один ход. Правило большинства
+    // применяется сразу при добавлении (более короткая серия не добавляется, более длинная вытесняет все прежние),
+    // поэтому в списке только серии, которые можно сделать, а не все найденные пути
+    template <size_t N>
+    struct unique_series : move_list<N, series>
+    {
+        void push_back(const series& turn)
+        {
+            if constexpr (Rules::Majority_capture) {
+                if (this->count && turn.hops < this->moves[0].hops)
+                    return;
+                if (this->count && turn.hops > this->moves[0].hops)
+                    this->clear();
+            }
+            for (size_t i = 0; i < this->count; ++i)
+                if (this->moves[i].same_position(turn))
+                    return;
+            move_list<N, series>::push_back(turn);
+        }
+    };
+
+    template <class List>
+    void find_quiets(const board_mtx& mtx, const uint64_t occupied, const POS_T x, const POS_T y, List& out) const // Добавляет в out все ходы шашки на (x, y) без взятия
     {
-        assert(mtx.size() == 8 && !mtx.empty() && mtx[0].size() == 8 && "Invalid matrix size in find_turns");
-        assert(x < 8 && y < 8 && "Invalid position");
-        turns.clear();
-        have_beats = false;
         POS_T type = mtx[x][y];
-        // check beats
         switch (type) {
         case 1:
         case 2:
-            for (POS_T i = x - 2; i <= x + 2; i += 4) {
-                for (POS_T j = y - 2; j <= y + 2; j += 4) {
-                    if (i < 0 || i > 7 || j < 0 || j > 7) continue;
-                    POS_T xb = (x + i) / 2, yb = (y + j) / 2;
-                    if (mtx[i][j] || !mtx[xb][yb] || mtx[xb][yb] % 2 == type % 2) continue;
-                    turns.emplace_back(x, y, i, j, xb, yb);
-                }
+        {
+            POS_T i = ((type % 2) ? x - 1 : x + 1);
+            for (POS_T j = y - 1; j <= y + 1; j += 2) {
+                if (i < 0 || i >= Size || j < 0 || j >= Size || mtx[i][j]) continue;
+                out.emplace_back(x, y, i, j);
             }
             break;
+        }
         default: // queens
-            for (POS_T i = -1; i <= 1; i += 2) {
-                for (POS_T j = -1; j <= 1; j += 2) {
-                    POS_T xb = -1, yb = -1;
-                    for (POS_T i2 = x + i, j2 = y + j; i2 >= 0 && i2 < 8 && j2 >= 0 && j2 < 8; i2 += i, j2 += j) {
-                        if (mtx[i2][j2]) {
-                            if (mtx[i2][j2] % 2 == type % 2 || (mtx[i2][j2] % 2 != type % 2 && xb != -1)) break;
-                            xb = i2;
-                            yb = j2;
-                        }
-                        if (xb != -1 && xb != i2) {
-                            turns.emplace_back(x, y, i2, j2, xb, yb);
-                        }
+            if constexpr (Rules::Flying_kings) {    // Все свободные клетки лучей до первой шашки, от ближней к дальней
+                for (int d = 0; d < rays::Directions; ++d)
+                    for (uint64_t free = rays::free_squares(rays::square(x, y), d, occupied); free;) {
+                        const int to = rays::pop_nearest(free, d);
+                        out.emplace_back(x, y, rays::row(to), rays::col(to));
+                    }
+            }
+            else {  // Дамка ходит на одно поле
+                for (POS_T i = -1; i <= 1; i += 2) {
+                    for (POS_T j = -1; j <= 1; j += 2) {
+                        const POS_T i2 = x + i, j2 = y + j;
+                        if (inside(i2, j2) && !mtx[i2][j2])
+                            out.emplace_back(x, y, i2, j2);
                     }
                 }
             }
             break;
         }
-        // check other turns
-        if (!turns.empty()) {
-            have_beats = true;
-            return;
-        }
-        switch (type) {
-        case 1:
-        case 2:
+    }
+
+    // Поэтапная генерация ходов для поиска: ход из кэша (если передан), затем взятия, затем тихие ходы.
+    // Взятия — серии целиком (одна серия — один ход). Тихие ходы генерируются по одной шашке и только когда
+    // до них дошла очередь, поэтому узел, в котором отсечение случилось раньше, не платит за полную генерацию.
+    // Всё хранится на стеке.
+    class move_picker
+    {
+    public:
+        move_picker(Logic* logic, const board_mtx& mtx, const bool color, const move_pos& hash_move = move_pos())
+            : logic(logic), mtx(mtx), color(color), hash_move(hash_move)
         {
-            POS_T i = ((type % 2) ? x - 1 : x + 1);
-            for (POS_T j = y - 1; j <= y + 1; j += 2) {
-                if (i < 0 || i > 7 || j < 0 || j > 7 || mtx[i][j]) continue;
-                turns.emplace_back(x, y, i, j);
+            for (POS_T i = 0; i < Size; ++i) {
+                for (POS_T j = (i + 1) % 2; j < Size; j += 2) {
+                    if (!mtx[i][j])
+                        continue;
+                    occupied |= rays::bit(i, j);
+                    if (mtx[i][j] % 2 != color)
+                        pieces[pieces_count++] = { i, j };
+                }
             }
-            break;
+            for (size_t k = 0; k < pieces_count; ++k)
+                logic->find_series(mtx, occupied, pieces[k].first, pieces[k].second, beats);   // Правило большинства — в beats.push_back
+            if (beats.dropped)   // Взятий больше ёмкости списка: ищем среди первых Max_moves, остальные не рассматриваются
+                logic->report_overflow(beats.dropped);
+            if (!beats.empty()) {
+                std::shuffle(beats.begin(), beats.end(), logic->rand_eng);
+            }
+            stage = (hash_move.x != -1 ? stage_t::HASH : stage_t::BEATS);
         }
-        default: // queens
-            for (POS_T i = -1; i <= 1; i += 2) {
-                for (POS_T j = -1; j <= 1; j += 2) {
-                    for (POS_T i2 = x + i, j2 = y + j; i2 >= 0 && i2 < 8 && j2 >= 0 && j2 < 8; i2 += i, j2 += j) {
-                        if (mtx[i2][j2]) break;
-                        turns.emplace_back(x, y, i2, j2);
+
+        bool have_beats() const // Есть ли взятия (тогда тихие ходы запрещены)
+        {
+            return !beats.empty();
+        }
+
+        bool next(series& turn)   // Следующий ход; false, если ходы закончились
+        {
+            while (true) {
+                switch (stage) {
+                case stage_t::HASH:
+                    stage = stage_t::BEATS;
+                    if (find(hash_move, turn)) {
+                        hash_used = true;
+                        return true;
+                    }
+                    break;
+                case stage_t::BEATS:
+                    if (beat_idx < beats.size()) {
+                        turn = beats[beat_idx++];
+                        if (hash_used && !hash_skipped && turn.matches(hash_move)) {   // Первая совпавшая серия — та, что выдал find
+                            hash_skipped = true;
+                            continue;
+                        }
+                        return true;
+                    }
+                    stage = (have_beats() ? stage_t::DONE : stage_t::QUIETS);
+                    if (stage == stage_t::QUIETS) {
+                        std::shuffle(pieces.begin(), pieces.begin() + pieces_count, logic->rand_eng);
+                    }
+                    break;
+                case stage_t::QUIETS:
+                    if (quiet_idx < quiets.size()) {
+                        const move_pos& quiet = quiets[quiet_idx++];
+                        if (hash_used && quiet == hash_move)
+                            continue;
+                        turn = series::quiet(quiet, promotes(mtx[quiet.x][quiet.y], quiet.x2));
+                        return true;
+                    }
+                    if (piece_idx == pieces_count) {
+                        stage = stage_t::DONE;
+                        break;
+                    }
+                    quiets.clear();
+                    quiet_idx = 0;
+                    logic->find_quiets(mtx, occupied, pieces[piece_idx].first, pieces[piece_idx].second, quiets);
+                    ++piece_idx;
+                    if (!quiets.empty()) {
+                        std::shuffle(quiets.begin(), quiets.end(), logic->rand_eng);
                     }
+                    break;
+                case stage_t::DONE:
+                    return false;
                 }
             }
-            break;
         }
-    }
+
+        bool find(const move_pos& key, series& turn) const   // Ход по краткой записи (из кэша позиций), если он допустим в этой позиции
+        {
+            if (key.x < 0 || !mtx[key.x][key.y] || mtx[key.x][key.y] % 2 == color)
+                return false;
+            if (have_beats()) {
+                for (const auto& beat : beats)
+                    if (beat.matches(key)) {
+                        turn = beat;
+                        return true;
+                    }
+                return false;
+            }
+            if (key.xb != -1)
+                return false;
+            move_list<Max_piece_moves> own;
+            logic->find_quiets(mtx, occupied, key.x, key.y, own);
+            for (const auto& quiet : own)
+                if (quiet == key) {
+                    turn = series::quiet(key, promotes(mtx[key.x][key.y], key.x2));
+                    return true;
+                }
+            return false;
+        }
+
+    private:
+        enum class stage_t { HASH, BEATS, QUIETS, DONE };
+
+        Logic* logic;   // Генератор ходов и генератор случайных чисел
+        const board_mtx& mtx;   // Позиция, для которой генерируются ходы
+        uint64_t occupied = 0;  // Занятые клетки позиции (маска rays::square)
+        bool color; // Цвет стороны, которая ходит
+        move_pos hash_move; // Ход из кэша позиций (пустой, если нет)
+        bool hash_used = false; // Ход из кэша уже выдан
+        bool hash_skipped = false;  // Серия из кэша уже пропущена среди взятий
+        stage_t stage = stage_t::BEATS;   // Текущий этап генерации
+        unique_series<Max_moves> beats; // Все взятия стороны (генерируются сразу: от них зависит, разрешены ли тихие ходы)
+        size_t beat_idx = 0;
+        std::array<std::pair<POS_T, POS_T>, Max_pieces> pieces;   // Шашки стороны, тихие ходы которых ещё не сгенерированы
+        size_t pieces_count = 0, piece_idx = 0;
+        move_list<Max_piece_moves> quiets;  // Тихие ходы текущей шашки
+        size_t quiet_idx = 0;
+    };
 
 public:
-    std::vector<move_pos> turns;  // Список всех возможных ходов для текущего состояния
+    std::vector<move_pos> turns;  // Список всех возможных ходов (прыжков серии) для текущего состояния
     bool have_beats;  // Флаг, указывающий, есть ли доступные ходы с битьём
     int Max_depth;  // Максимальная глубина поиска для алгоритма минимиакса
 
 private:
+    struct ply_guard    // Учёт узлов и текущего полухода (включая прыжки серии битья) на время вызова
+    {
+        explicit ply_guard(Logic* logic) : logic(logic)
+        {
+            ++logic->stats.nodes;
+            logic->stats.seldepth = std::max(logic->stats.seldepth, static_cast<int>(logic->ply));
+            ++logic->ply;
+        }
+        ~ply_guard()
+        {
+            --logic->ply;
+        }
+        Logic* logic;
+    };
+
+    struct path_guard   // Позиция после хода на стеке позиций поиска на время его обхода (для правил ничьей)
+    {
+        path_guard(Logic* logic, const board_mtx& mtx, const series& turn)
+            : logic(logic), base(logic->path_base), reversible(is_reversible(mtx, turn))
+        {
+            auto& path = logic->path;
+            if (reversible) {   // Ключ меняется только на дамку и очередь хода
+                const int piece = mtx[turn.x][turn.y] - 1;
+                path.push_back(path.back() ^ zobrist_key((turn.x * Size + turn.y) * 4 + piece) ^
+                               zobrist_key((turn.x2 * Size + turn.y2) * 4 + piece) ^ zobrist_key(Size * Size * 4));
+            }
+            else {  // Необратимый ход: прежние позиции повториться не могут, отсчёт начинается заново. Ключи после него
+                    // сравниваются только между собой, поэтому начальным служит верхний ключ стека — полный ключ не нужен
+                logic->path_base = path.size() - 1;
+            }
+        }
+        ~path_guard()
+        {
+            if (reversible)
+                logic->path.pop_back();
+            logic->path_base = base;
+        }
+        Logic* logic;
+        size_t base;    // path_base до хода
+        bool reversible;    // Ход положил ключ на стек
+    };
+
     std::default_random_engine rand_eng;  // Генератор случайных чисел для перемешивания ходов
     std::string optimization;  // Уровень оптимизации (например, "O0" для отсутствия альфа-бета обрезки)
-    std::vector<move_pos> next_move;  // Список лучших ходов для каждого состояния в дереве поиска
-    std::vector<int> next_best_state;  // Список индексов следующего лучшего состояния для каждого состояния
     Board* board;  // Указатель на объект доски для доступа к её состоянию
     Config* config;  // Указатель на объект конфигурации для получения параметров бота
+    search_stats stats;  // Статистика текущего (или последнего) поиска
+    Transposition_table* table = nullptr;  // Таблица транспозиций (не владеет, может отсутствовать)
+    const std::atomic<bool>* stop = nullptr;  // Внешний флаг отмены поиска
+    std::chrono::steady_clock::time_point deadline;  // Крайний срок поиска (пустой — без ограничения)
+    bool stopped = false;  // Поиск прерван
+    stats_listener on_stats;  // Подписчик на статистику поиска
+    size_t ply = 0;  // Текущий полуход от корня поиска
+    eval_weights weights = eval_weights(Size);  // Веса оценки calc_score (по умолчанию шашка 1, дамка 4)
+    std::shared_ptr<const Nnue<Size>> nnue;  // Нейросетевая оценка (nullptr — материальная calc_score)
+    std::vector<nnue_accumulator> accumulators;  // Аккумуляторы сети по полуходам текущего пути поиска
+    std::vector<uint64_t> history;  // Ключи позиций партии с последнего необратимого хода (set_history)
+    std::vector<uint64_t> path;  // Стек ключей позиций: история партии и текущий путь поиска
+    size_t path_base = 0;  // Первая позиция path после последнего необратимого хода
+    size_t path_root = 0;  // Позиция корня поиска в path
+    bool path_draw = false;  // В поддереве текущего узла была ничья, зависящая от пути (draw_by_rules с path_dependent)
+    std::vector<series> legal;  // Ходы позиции на доске (find_turns) с учётом уже сделанных прыжков серии
+    size_t hop_index = 0;  // Сделано прыжков серии на доске
 };
\ No newline at end of file
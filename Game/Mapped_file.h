@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Файл только для чтения, отображённый в память (mmap): данные читаются по смещению без копирования,
+// страницы подгружаются по мере обращения. На Windows файл читается в память целиком.
+class Mapped_file
+{
+  public:
+    Mapped_file() = default;
+    Mapped_file(const Mapped_file &) = delete;
+    Mapped_file &operator=(const Mapped_file &) = delete;
+
+    ~Mapped_file()
+    {
+        close();
+    }
+
+    bool open(const std::string &path, std::string &error)
+    {
+        close();
+#ifndef _WIN32
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0)
+        {
+            if (fd >= 0)
+                ::close(fd);
+            error = "can't open " + path;
+            return false;
+        }
+        mapped_size = size_t(st.st_size);
+        if (mapped_size > 0)
+        {
+            void *addr = mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (addr == MAP_FAILED)
+            {
+                ::close(fd);
+                mapped_size = 0;
+                error = "can't map " + path;
+                return false;
+            }
+            mapped = static_cast<const char *>(addr);
+        }
+        ::close(fd);    // Отображение остаётся действительным после закрытия дескриптора
+#else
+        std::ifstream fin(path, std::ios_base::binary);
+        if (!fin)
+        {
+            error = "can't open " + path;
+            return false;
+        }
+        copy.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+#endif
+        return true;
+    }
+
+    void close()
+    {
+#ifndef _WIN32
+        if (mapped)
+            munmap(const_cast<char *>(mapped), mapped_size);
+        mapped = nullptr;
+        mapped_size = 0;
+#else
+        copy.clear();
+#endif
+    }
+
+    const char *data() const
+    {
+#ifndef _WIN32
+        return mapped;
+#else
+        return copy.data();
+#endif
+    }
+
+    size_t size() const
+    {
+#ifndef _WIN32
+        return mapped_size;
+#else
+        return copy.size();
+#endif
+    }
+
+  private:
+#ifndef _WIN32
+    const char *mapped = nullptr;   // Отображённый файл
+    size_t mapped_size = 0;
+#else
+    std::vector<char> copy; // Содержимое файла
+#endif
+};
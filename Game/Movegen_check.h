@@ -0,0 +1,222 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Config.h"
+#include "Logger.h"
+#include "Logic.h"
+
+// Проверка генератора ходов (режим checkers --check-movegen): ходы Logic::legal_turns на случайных позициях
+// сравниваются с эталонным генератором — прямым обходом диагоналей по клеткам матрицы, без лучей, масок и списков
+// на стеке. Сравниваются позиции после хода (в них видны начальная и конечная клетки, съеденные шашки и превращение
+// в дамку): генератор не должен терять ходы, добавлять лишние и выдавать одну позицию дважды. Позиции — случайные
+// расстановки шашек и дамок (не больше move_series::Max_hops шашек одного цвета) с фиксированным зерном, поэтому
+// проверку можно повторить.
+template <class Rules>
+class Movegen_check
+{
+  public:
+    typedef typename Logic<Rules>::board_mtx board_mtx;
+    static constexpr POS_T Size = Rules::Size;
+    static constexpr size_t Max_side = move_series<Size>::Max_hops;    // Шашек одного цвета в случайной позиции
+    static constexpr size_t Max_reports = 10;  // Расхождений, записанных в лог подробно
+
+    explicit Movegen_check(Config *config, const std::string &name) : generator(nullptr, config), name(name)
+    {
+    }
+
+    int run(const size_t positions, const uint32_t seed)   // 0 — генератор совпал с эталоном на всех позициях
+    {
+        std::mt19937 rng(seed);
+        size_t moves = 0, mismatches = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t n = 0; n < positions; ++n)
+        {
+            const board_mtx mtx = random_position(rng);
+            const bool color = rng() & 1;
+            std::vector<board_mtx> expected = reference_turns(mtx, color);
+            std::sort(expected.begin(), expected.end());
+            expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+            std::vector<board_mtx> actual;
+            for (const auto &turn : generator.legal_turns(mtx, color))
+                actual.push_back(generator.apply_turns(mtx, turn));
+            std::sort(actual.begin(), actual.end());
+            moves += actual.size();
+            if (actual == expected)
+                continue;
+            if (++mismatches <= Max_reports)
+                Logger::instance().error("Move generator mismatch",
+                                         {{"variant", name}, {"position", n}, {"board", board_string(mtx)}, {"color", color ? 1 : 0},
+                                          {"moves", actual.size()}, {"expected", expected.size()}});
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        Logger::instance().info("Move generator check", {{"variant", name}, {"positions", positions}, {"seed", seed},
+                                                         {"moves", moves}, {"mismatches", mismatches}, {"time_ms", ms}});
+        std::cout << name << ": " << positions << " positions, " << moves << " moves, " << mismatches << " mismatches"
+                  << std::endl;
+        return mismatches ? 1 : 0;
+    }
+
+  private:
+    static board_mtx random_position(std::mt19937 &rng)  // Случайная расстановка; простых шашек на последнем для них ряду нет
+    {
+        board_mtx mtx{};
+        const size_t kings = rng() % 4;    // Доля дамок: 0, 1/3, 2/3 или все
+        for (const POS_T color : {POS_T(0), POS_T(1)})
+        {
+            const size_t count = 1 + rng() % Max_side;
+            for (size_t placed = 0; placed < count;)
+            {
+                const POS_T i = rng() % Size, j = rng() % Size;
+                if ((i + j) % 2 == 0 || mtx[i][j])
+                    continue;
+                POS_T piece = 1 + color + (rng() % 3 < kings ? 2 : 0);
+                if (promotes(piece, i))
+                    piece += 2;
+                mtx[i][j] = piece;
+                ++placed;
+            }
+        }
+        return mtx;
+    }
+
+    static std::string board_string(const board_mtx &mtx)   // Доска для лога: ряды сверху вниз через '/', клетка — код шашки
+    {
+        std::string res;
+        for (POS_T i = 0; i < Size; ++i)
+        {
+            if (i)
+                res += '/';
+            for (POS_T j = 0; j < Size; ++j)
+                res += char('0' + mtx[i][j]);
+        }
+        return res;
+    }
+
+    static bool promotes(const POS_T piece, const POS_T row)
+    {
+        return (piece == 1 && row == 0) || (piece == 2 && row == Size - 1);
+    }
+
+    static bool inside(const int i, const int j)
+    {
+        return i >= 0 && i < Size && j >= 0 && j < Size;
+    }
+
+    struct capture_state   // Серия взятий эталонного генератора
+    {
+        POS_T x, y;     // Начальная клетка
+        std::vector<std::pair<POS_T, POS_T>> captured;  // Съеденные шашки (стоят на доске до конца хода)
+
+        bool is_captured(const int i, const int j) const
+        {
+            return std::find(captured.begin(), captured.end(), std::make_pair(POS_T(i), POS_T(j))) != captured.end();
+        }
+    };
+
+    static std::vector<board_mtx> reference_turns(const board_mtx &mtx, const bool color)  // Позиции после всех ходов стороны
+    {
+        std::vector<std::pair<size_t, board_mtx>> captures;    // Число съеденных шашек и позиция после хода
+        for (POS_T i = 0; i < Size; ++i)
+            for (POS_T j = 0; j < Size; ++j)
+                if (mtx[i][j] && mtx[i][j] % 2 != color)
+                {
+                    board_mtx board = mtx;
+                    board[i][j] = 0;    // Шашка ушла с начальной клетки
+                    capture_state s{i, j, {}};
+                    reference_captures(mtx, board, i, j, mtx[i][j], s, captures);
+                }
+        std::vector<board_mtx> res;
+        if (!captures.empty())
+        {
+            size_t best = 0;
+            for (const auto &c : captures)
+                best = std::max(best, c.first);
+            for (const auto &c : captures)
+                if (!Rules::Majority_capture || c.first == best)
+                    res.push_back(c.second);
+            return res;
+        }
+        for (POS_T i = 0; i < Size; ++i)
+            for (POS_T j = 0; j < Size; ++j)
+            {
+                const POS_T piece = mtx[i][j];
+                if (!piece || piece % 2 == color)
+                    continue;
+                for (const int di : {-1, 1})
+                    for (const int dj : {-1, 1})
+                    {
+                        if (piece <= 2 && (piece == 1) != (di < 0))
+                            continue;   // Простая шашка ходит только вперёд
+                        for (int k = 1; inside(i + k * di, j + k * dj) && !mtx[i + k * di][j + k * dj]; ++k)
+                        {
+                            board_mtx board = mtx;
+                            board[i][j] = 0;
+                            board[i + k * di][j + k * dj] = promotes(piece, i + k * di) ? piece + 2 : piece;
+                            res.push_back(board);
+                            if (piece <= 2 || !Rules::Flying_kings)
+                                break;
+                        }
+                    }
+            }
+        return res;
+    }
+
+    // Продолжения серии шашкой type с (x, y); board — доска без ходящей шашки, съеденные шашки остаются на ней
+    static void reference_captures(const board_mtx &mtx, const board_mtx &board, const POS_T x, const POS_T y, const POS_T type,
+                                   capture_state &s, std::vector<std::pair<size_t, board_mtx>> &out)
+    {
+        bool extended = false;
+        for (const int di : {-1, 1})
+            for (const int dj : {-1, 1})
+            {
+                if (!Rules::Men_capture_backward && type <= 2 && (type == 1) != (di < 0))
+                    continue;
+                const bool flying = type > 2 && Rules::Flying_kings;
+                int k = 1;
+                while (flying && inside(x + k * di, y + k * dj) && !board[x + k * di][y + k * dj])
+                    ++k;
+                const int xb = x + k * di, yb = y + k * dj;
+                if (!inside(xb, yb) || !board[xb][yb] || board[xb][yb] % 2 == type % 2 || s.is_captured(xb, yb))
+                    continue;
+                for (int l = 1; inside(xb + l * di, yb + l * dj) && !board[xb + l * di][yb + l * dj]; ++l)
+                {
+                    const POS_T x2 = xb + l * di, y2 = yb + l * dj;
+                    extended = true;
+                    s.captured.emplace_back(xb, yb);
+                    if (Rules::Crowning_rule != Crowning::AT_END && promotes(type, x2))
+                    {
+                        if (Rules::Crowning_rule == Crowning::STOP)
+                            out.emplace_back(s.captured.size(), result(mtx, s, x2, y2, type + 2));
+                        else
+                            reference_captures(mtx, board, x2, y2, type + 2, s, out);
+                    }
+                    else
+                        reference_captures(mtx, board, x2, y2, type, s, out);
+                    s.captured.pop_back();
+                    if (!flying)
+                        break;
+                }
+            }
+        if (!extended && !s.captured.empty())
+            out.emplace_back(s.captured.size(),
+                             result(mtx, s, x, y, Rules::Crowning_rule == Crowning::AT_END && promotes(type, x) ? type + 2 : type));
+    }
+
+    static board_mtx result(board_mtx mtx, const capture_state &s, const POS_T x, const POS_T y, const POS_T type)
+    {
+        mtx[s.x][s.y] = 0;
+        for (const auto &c : s.captured)
+            mtx[c.first][c.second] = 0;
+        mtx[x][y] = type;
+        return mtx;
+    }
+
+    Logic<Rules> generator;
+    std::string name;  // Вариант для лога
+};
@@ -0,0 +1,251 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+#include "../Models/Hash.h"
+#include "../Models/Move.h"
+
+constexpr int Nnue_hidden = 64;    // Ширина скрытого слоя (кратна 32 — одному регистру AVX2 из int8)
+
+struct alignas(32) nnue_accumulator // Сумма весов активных признаков первого слоя; обновляется на каждом ходе поиска
+{
+    int16_t values[Nnue_hidden];    // Значения нейронов скрытого слоя до активации
+    int pieces[2] = {0, 0};         // Количество шашек белых и чёрных (для проверки конца игры без обхода доски)
+};
+
+// Небольшая квантованная сеть оценки (в духе NNUE): признаки "тип шашки на тёмной клетке" -> 64 нейрона (int16,
+// обновляются инкрементально) -> clipped ReLU [0, 127] -> int8-веса выхода -> логит выигрыша белых.
+// Файл весов (little-endian): "CKNN", uint32 версия, uint32 число признаков, uint32 ширина слоя, float масштаб выхода,
+// int16 веса признаков [признак][нейрон], int16 смещения, int8 веса выхода, int32 смещение выхода.
+template <POS_T Size>
+class Nnue
+{
+  public:
+    static constexpr int Features = 4 * Size * Size / 2;  // 4 типа шашек на каждой тёмной клетке
+    static constexpr int Hidden = Nnue_hidden;
+    static constexpr uint32_t Version = 1;
+
+    Nnue() : weights(new layers())
+    {
+    }
+
+    bool load(const std::string &path, std::string &error)  // Загрузка весов из файла; при ошибке веса не меняются
+    {
+        std::ifstream fin(path, std::ios_base::binary);
+        if (!fin)
+        {
+            error = "can't open " + path;
+            return false;
+        }
+        char magic[4];
+        uint32_t version = 0, features = 0, hidden = 0;
+        fin.read(magic, 4);
+        fin.read(reinterpret_cast<char *>(&version), sizeof(version));
+        fin.read(reinterpret_cast<char *>(&features), sizeof(features));
+        fin.read(reinterpret_cast<char *>(&hidden), sizeof(hidden));
+        if (!fin || std::memcmp(magic, "CKNN", 4) != 0 || version != Version)
+        {
+            error = path + " is not a weights file of version " + std::to_string(Version);
+            return false;
+        }
+        if (features != uint32_t(Features) || hidden != uint32_t(Hidden))
+        {
+            error = path + " has " + std::to_string(features) + "x" + std::to_string(hidden) + " layer, expected " +
+                    std::to_string(Features) + "x" + std::to_string(Hidden);
+            return false;
+        }
+        std::unique_ptr<layers> loaded(new layers());
+        fin.read(reinterpret_cast<char *>(&loaded->output_scale), sizeof(loaded->output_scale));
+        fin.read(reinterpret_cast<char *>(loaded->feature), sizeof(loaded->feature));
+        fin.read(reinterpret_cast<char *>(loaded->bias), sizeof(loaded->bias));
+        fin.read(reinterpret_cast<char *>(loaded->output), sizeof(loaded->output));
+        fin.read(reinterpret_cast<char *>(&loaded->output_bias), sizeof(loaded->output_bias));
+        if (!fin || !(loaded->output_scale > 0))
+        {
+            error = path + " is truncated or has invalid output scale";
+            return false;
+        }
+        weights = std::move(loaded);
+        return true;
+    }
+
+    uint64_t fingerprint() const    // Отпечаток весов (меняется с любым весом сети)
+    {
+        uint64_t hash = hash_bytes(weights->feature, sizeof(weights->feature));
+        hash = hash_bytes(weights->bias, sizeof(weights->bias), hash);
+        hash = hash_bytes(weights->output, sizeof(weights->output), hash);
+        hash = hash_bytes(&weights->output_bias, sizeof(weights->output_bias), hash);
+        return hash_bytes(&weights->output_scale, sizeof(weights->output_scale), hash);
+    }
+
+    bool save(const std::string &path) const    // Запись весов в файл того же формата
+    {
+        std::ofstream fout(path, std::ios_base::binary | std::ios_base::trunc);
+        const uint32_t header[] = {Version, uint32_t(Features), uint32_t(Hidden)};
+        fout.write("CKNN", 4);
+        fout.write(reinterpret_cast<const char *>(header), sizeof(header));
+        fout.write(reinterpret_cast<const char *>(&weights->output_scale), sizeof(weights->output_scale));
+        fout.write(reinterpret_cast<const char *>(weights->feature), sizeof(weights->feature));
+        fout.write(reinterpret_cast<const char *>(weights->bias), sizeof(weights->bias));
+        fout.write(reinterpret_cast<const char *>(weights->output), sizeof(weights->output));
+        fout.write(reinterpret_cast<const char *>(&weights->output_bias), sizeof(weights->output_bias));
+        return bool(fout);
+    }
+
+    template <class Mtx> void refresh(const Mtx &mtx, nnue_accumulator &acc) const  // Полный пересчёт аккумулятора по доске (в корне поиска)
+    {
+        std::memcpy(acc.values, weights->bias, sizeof(acc.values));
+        acc.pieces[0] = acc.pieces[1] = 0;
+        for (POS_T i = 0; i < Size; ++i)
+            for (POS_T j = 0; j < Size; ++j)
+                if (mtx[i][j])
+                    add(acc, i, j, mtx[i][j]);
+    }
+
+    void add(nnue_accumulator &acc, const POS_T i, const POS_T j, const POS_T piece) const   // Шашка piece появилась на (i, j)
+    {
+        add_row(acc.values, weights->feature[feature(i, j, piece)]);
+        ++acc.pieces[(piece + 1) % 2];
+    }
+
+    void remove(nnue_accumulator &acc, const POS_T i, const POS_T j, const POS_T piece) const    // Шашка piece ушла с (i, j)
+    {
+        sub_row(acc.values, weights->feature[feature(i, j, piece)]);
+        --acc.pieces[(piece + 1) % 2];
+    }
+
+    double evaluate(const nnue_accumulator &acc) const  // Логит выигрыша белых (>0 — лучше белым)
+    {
+        return (dot(acc.values, weights->output) + weights->output_bias) / weights->output_scale;
+    }
+
+    // Прямой доступ к весам (для обучения и генерации файлов весов)
+    int16_t &feature_weight(const int feature_index, const int neuron)
+    {
+        return weights->feature[feature_index][neuron];
+    }
+    int16_t &bias(const int neuron)
+    {
+        return weights->bias[neuron];
+    }
+    int8_t &output_weight(const int neuron)
+    {
+        return weights->output[neuron];
+    }
+    int32_t &output_bias()
+    {
+        return weights->output_bias;
+    }
+    float &output_scale()
+    {
+        return weights->output_scale;
+    }
+
+    static int feature(const POS_T i, const POS_T j, const POS_T piece)    // Номер признака: тип шашки (1..4) на тёмной клетке (i, j)
+    {
+        return (piece - 1) * (Size * Size / 2) + (i * Size + j) / 2;
+    }
+
+  private:
+    struct layers
+    {
+        alignas(32) int16_t feature[Features][Hidden] = {};   // Веса первого слоя по признакам
+        alignas(32) int16_t bias[Hidden] = {};  // Смещения первого слоя
+        alignas(32) int8_t output[Hidden] = {}; // Веса выходного нейрона
+        int32_t output_bias = 0;    // Смещение выходного нейрона
+        float output_scale = 1; // Делитель выхода: логит = выход / output_scale
+    };
+
+    static void add_row(int16_t *acc, const int16_t *row)   // acc += row
+    {
+#if defined(__AVX2__)
+        for (int i = 0; i < Hidden; i += 16)
+        {
+            const __m256i sum = _mm256_add_epi16(_mm256_load_si256(reinterpret_cast<const __m256i *>(acc + i)),
+                                                 _mm256_load_si256(reinterpret_cast<const __m256i *>(row + i)));
+            _mm256_store_si256(reinterpret_cast<__m256i *>(acc + i), sum);
+        }
+#elif defined(__SSSE3__)
+        for (int i = 0; i < Hidden; i += 8)
+        {
+            const __m128i sum = _mm_add_epi16(_mm_load_si128(reinterpret_cast<const __m128i *>(acc + i)),
+                                              _mm_load_si128(reinterpret_cast<const __m128i *>(row + i)));
+            _mm_store_si128(reinterpret_cast<__m128i *>(acc + i), sum);
+        }
+#else
+        for (int i = 0; i < Hidden; ++i)
+            acc[i] += row[i];
+#endif
+    }
+
+    static void sub_row(int16_t *acc, const int16_t *row)   // acc -= row
+    {
+#if defined(__AVX2__)
+        for (int i = 0; i < Hidden; i += 16)
+        {
+            const __m256i diff = _mm256_sub_epi16(_mm256_load_si256(reinterpret_cast<const __m256i *>(acc + i)),
+                                                  _mm256_load_si256(reinterpret_cast<const __m256i *>(row + i)));
+            _mm256_store_si256(reinterpret_cast<__m256i *>(acc + i), diff);
+        }
+#elif defined(__SSSE3__)
+        for (int i = 0; i < Hidden; i += 8)
+        {
+            const __m128i diff = _mm_sub_epi16(_mm_load_si128(reinterpret_cast<const __m128i *>(acc + i)),
+                                               _mm_load_si128(reinterpret_cast<const __m128i *>(row + i)));
+            _mm_store_si128(reinterpret_cast<__m128i *>(acc + i), diff);
+        }
+#else
+        for (int i = 0; i < Hidden; ++i)
+            acc[i] -= row[i];
+#endif
+    }
+
+    // Выходной слой: clipped ReLU аккумулятора в uint8 и скалярное произведение с int8-весами.
+    // |127 * 127 * 2| < 32767, поэтому попарные суммы maddubs не насыщаются.
+    static int32_t dot(const int16_t *acc, const int8_t *output)
+    {
+#if defined(__AVX2__)
+        const __m256i zero = _mm256_setzero_si256(), max = _mm256_set1_epi16(127), ones = _mm256_set1_epi16(1);
+        __m256i sum = zero;
+        for (int i = 0; i < Hidden; i += 32)
+        {
+            const __m256i lo = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256(reinterpret_cast<const __m256i *>(acc + i)), zero), max);
+            const __m256i hi = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256(reinterpret_cast<const __m256i *>(acc + i + 16)), zero), max);
+            const __m256i relu = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8); // packus смешивает 128-битные половины
+            const __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i *>(output + i));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(relu, w), ones));
+        }
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+        return _mm_cvtsi128_si32(s);
+#elif defined(__SSSE3__)
+        const __m128i zero = _mm_setzero_si128(), max = _mm_set1_epi16(127), ones = _mm_set1_epi16(1);
+        __m128i sum = zero;
+        for (int i = 0; i < Hidden; i += 16)
+        {
+            const __m128i lo = _mm_min_epi16(_mm_max_epi16(_mm_load_si128(reinterpret_cast<const __m128i *>(acc + i)), zero), max);
+            const __m128i hi = _mm_min_epi16(_mm_max_epi16(_mm_load_si128(reinterpret_cast<const __m128i *>(acc + i + 8)), zero), max);
+            const __m128i w = _mm_load_si128(reinterpret_cast<const __m128i *>(output + i));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(_mm_packus_epi16(lo, hi), w), ones));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        return _mm_cvtsi128_si32(sum);
+#else
+        int32_t sum = 0;
+        for (int i = 0; i < Hidden; ++i)
+            sum += std::clamp<int16_t>(acc[i], 0, 127) * output[i];
+        return sum;
+#endif
+    }
+
+    std::unique_ptr<layers> weights;    // Веса сети (выровнены для SIMD)
+};
@@ -0,0 +1,321 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Models/Project_path.h"
+#include "Config.h"
+#include "Logger.h"
+#include "Logic.h"
+#include "Nnue.h"
+#include "Training_data.h"
+
+// Обучение нейросетевой оценки (режим checkers --train-nnue) по файлу обучающих данных Nnue.DataFile
+// (позиции, записанные через Bot.TrainingFile или Tune.DataFile):
+// 1) сеть той же формы, что и Nnue, обучается во float: скрытый нейрон — clamp(смещение + сумма весов признаков, 0, 1),
+//    выход — логит выигрыша белых; по спокойным позициям с результатом партии минимизируется средний квадрат ошибки
+//    прогноза 1 / (1 + exp(-логит)) мини-батчами (Adam), градиент батча считается параллельно;
+// 2) веса квантуются в формат Nnue: веса признаков и смещения — int16 с единицей 127 (граница clipped ReLU),
+//    веса выхода — int8 с масштабом по наибольшему весу, который записывается как output_scale;
+// 3) ошибка квантованной сети проверяется через Nnue::evaluate, веса записываются Nnue::save в Nnue.Output
+//    (укажите его в Bot.NnueFile).
+template <class Rules>
+class Nnue_trainer
+{
+  public:
+    static constexpr POS_T Size = Rules::Size;
+    static constexpr int Features = Nnue<Size>::Features;
+    static constexpr int Hidden = Nnue<Size>::Hidden;
+    static constexpr float Unit = 127;  // Значение аккумулятора, соответствующее 1.0 (верх clipped ReLU)
+    static constexpr float Max_weight = 2;  // Предел весов первого слоя: 2 * 127 * (тёмных клеток + смещение) < 32767, аккумулятор int16 не переполняется
+
+    explicit Nnue_trainer(Config *config) : config(config)
+    {
+        threads_count = std::max(1, int((*config)("Nnue", "Threads")));
+    }
+
+    int run()   // Обучение, квантование и запись файла весов; 0 при успехе
+    {
+        const std::string data_path = project_path + std::string((*config)("Nnue", "DataFile"));
+        std::string error;
+        if (!reader.open(data_path, Logic<Rules>::rules_version(), error))
+        {
+            Logger::instance().error("Nnue train error: " + error);
+            std::cout << "Nnue train error: " << error << std::endl;
+            return 1;
+        }
+        for (size_t i = 0; i < reader.size(); ++i)
+            if (usable(reader[i]))
+                ++used;
+        Logger::instance().info("Nnue train data file", {{"file", data_path}, {"positions", reader.size()}, {"used", used}});
+        std::cout << "Data file " << data_path << ": " << reader.size() << " positions, " << used << " quiet with result" << std::endl;
+        if (!used)
+        {
+            Logger::instance().error("Nnue train error: no positions to train on");
+            return 1;
+        }
+        init();
+        report("Initial", loss());
+        fit();
+
+        Nnue<Size> net;
+        quantize(net);
+        const double quantized = quantized_loss(net);
+        Logger::instance().info("Nnue train quantized", {{"mse", quantized}, {"output_scale", net.output_scale()}});
+        std::cout << "Quantized: mse " << quantized << std::endl;
+
+        const std::string path = project_path + std::string((*config)("Nnue", "Output"));
+        Nnue<Size> check;
+        if (!net.save(path) || !check.load(path, error) || check.fingerprint() != net.fingerprint())
+        {
+            Logger::instance().error("Nnue train error: can't write " + path);
+            return 1;
+        }
+        Logger::instance().info("Nnue weights written", {{"file", path}});
+        std::cout << "Weights written to " << path << std::endl;
+        return 0;
+    }
+
+  private:
+    typedef training_record<Size> record;
+
+    struct network  // Веса сети во float (параметры подряд: признаки, смещения, выход, смещение выхода)
+    {
+        static constexpr size_t Params = size_t(Features) * Hidden + 2 * Hidden + 1;
+
+        std::vector<float> w = std::vector<float>(Params, 0);
+
+        float &feature(const int f, const int k)
+        {
+            return w[size_t(f) * Hidden + k];
+        }
+        float &bias(const int k)
+        {
+            return w[size_t(Features) * Hidden + k];
+        }
+        float &output(const int k)
+        {
+            return w[size_t(Features) * Hidden + Hidden + k];
+        }
+        float &output_bias()
+        {
+            return w.back();
+        }
+    };
+
+    static bool usable(const record &r) // Спокойная позиция с известным результатом (как в Tuner)
+    {
+        return !r.capture() && r.result() != Game_result::UNKNOWN;
+    }
+
+    static double target(const record &r)   // 1 — победа белых, 0.5 — ничья, 0 — победа чёрных
+    {
+        return r.result() == Game_result::WHITE ? 1 : r.result() == Game_result::BLACK ? 0 : 0.5;
+    }
+
+    static double sigmoid(const double x)
+    {
+        return 1 / (1 + std::exp(-x));
+    }
+
+    static int active_features(const record &r, int *features)  // Признаки позиции (номера Nnue::feature); возвращает их число
+    {
+        int n = 0;
+        for (int k = 0; k < record::Squares; ++k)
+            if (const POS_T piece = r.piece_at(k))
+                features[n++] = Nnue<Size>::feature(record::row(k), record::col(k), piece);
+        return n;
+    }
+
+    double forward(const int *features, const int n, float *hidden)  // Логит выигрыша белых; hidden — нейроны до clamp
+    {
+        for (int k = 0; k < Hidden; ++k)
+            hidden[k] = net.bias(k);
+        for (int f = 0; f < n; ++f)
+        {
+            const float *row = &net.feature(features[f], 0);
+            for (int k = 0; k < Hidden; ++k)
+                hidden[k] += row[k];
+        }
+        double logit = net.output_bias();
+        for (int k = 0; k < Hidden; ++k)
+            logit += std::clamp(hidden[k], 0.0f, 1.0f) * net.output(k);
+        return logit;
+    }
+
+    void init() // Случайные начальные веса (фиксированное зерно): нейроны начинают в линейной части clamp
+    {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> small(-0.05f, 0.05f), out(-0.5f, 0.5f);
+        for (int f = 0; f < Features; ++f)
+            for (int k = 0; k < Hidden; ++k)
+                net.feature(f, k) = small(rng);
+        for (int k = 0; k < Hidden; ++k)
+        {
+            net.bias(k) = 0.5f;
+            net.output(k) = out(rng);
+        }
+    }
+
+    double loss()   // Средний квадрат ошибки прогноза по всем используемым позициям (параллельно)
+    {
+        std::vector<double> parts(threads_count, 0);
+        parallel(reader.size(), [&](const int t, const size_t from, const size_t to) {
+            int features[record::Squares];
+            float hidden[Hidden];
+            for (size_t i = from; i < to; ++i)
+            {
+                if (!usable(reader[i]))
+                    continue;
+                const double err = sigmoid(forward(features, active_features(reader[i], features), hidden)) - target(reader[i]);
+                parts[t] += err * err;
+            }
+        });
+        double sum = 0;
+        for (const double part : parts)
+            sum += part;
+        return sum / used;
+    }
+
+    double quantized_loss(const Nnue<Size> &quantized)  // Та же ошибка, но логит считает квантованная сеть Nnue
+    {
+        std::vector<double> parts(threads_count, 0);
+        parallel(reader.size(), [&](const int t, const size_t from, const size_t to) {
+            typename Logic<Rules>::board_mtx mtx;
+            nnue_accumulator acc;
+            for (size_t i = from; i < to; ++i)
+            {
+                if (!usable(reader[i]))
+                    continue;
+                reader[i].to_mtx(mtx);
+                quantized.refresh(mtx, acc);
+                const double err = sigmoid(quantized.evaluate(acc)) - target(reader[i]);
+                parts[t] += err * err;
+            }
+        });
+        double sum = 0;
+        for (const double part : parts)
+            sum += part;
+        return sum / used;
+    }
+
+    void fit()  // Мини-батчевый градиентный спуск (Adam) по всем весам сети
+    {
+        const int epochs = (*config)("Nnue", "Epochs");
+        const size_t batch_size = std::max(1, int((*config)("Nnue", "BatchSize")));
+        const double rate = (*config)("Nnue", "LearningRate");
+        std::vector<float> m(network::Params, 0), v(network::Params, 0);
+        std::vector<std::vector<float>> parts(threads_count, std::vector<float>(network::Params, 0));
+        std::vector<size_t> batch;
+        batch.reserve(batch_size);
+        int step = 0;
+        for (int epoch = 0; epoch < epochs; ++epoch)
+        {
+            Shuffled_order order(reader.size(), unsigned(epoch));
+            for (size_t index; ; batch.clear())
+            {
+                while (batch.size() < batch_size && order.next(index))
+                    if (usable(reader[index]))
+                        batch.push_back(index);
+                if (batch.empty())
+                    break;
+                for (auto &part : parts)
+                    std::fill(part.begin(), part.end(), 0.0f);
+                parallel(batch.size(), [&](const int t, const size_t from, const size_t to) {
+                    for (size_t k = from; k < to; ++k)
+                        add_gradient(reader[batch[k]], parts[t]);
+                });
+                ++step;
+                const double m_fix = 1 - std::pow(0.9, step), v_fix = 1 - std::pow(0.999, step);
+                for (size_t p = 0; p < network::Params; ++p)
+                {
+                    float g = 0;
+                    for (const auto &part : parts)
+                        g += part[p];
+                    g /= float(batch.size());
+                    m[p] = 0.9f * m[p] + 0.1f * g;
+                    v[p] = 0.999f * v[p] + 0.001f * g * g;
+                    net.w[p] -= float(rate * (m[p] / m_fix) / (std::sqrt(v[p] / v_fix) + 1e-8));
+                }
+                clip();
+            }
+            if ((epoch + 1) % std::max(1, epochs / 10) == 0)
+                report("Epoch " + std::to_string(epoch + 1), loss());
+        }
+    }
+
+    void add_gradient(const record &r, std::vector<float> &grad)   // Градиент квадрата ошибки одной позиции по весам
+    {
+        int features[record::Squares];
+        float hidden[Hidden];
+        const int n = active_features(r, features);
+        const double p = sigmoid(forward(features, n, hidden));
+        const float d_logit = float(2 * (p - target(r)) * p * (1 - p));
+        grad.back() += d_logit;
+        for (int k = 0; k < Hidden; ++k)
+        {
+            grad[size_t(Features) * Hidden + Hidden + k] += d_logit * std::clamp(hidden[k], 0.0f, 1.0f);
+            if (hidden[k] <= 0 || hidden[k] >= 1)
+                continue;   // clamp насыщен — градиент не проходит в первый слой
+            const float d_hidden = d_logit * net.output(k);
+            grad[size_t(Features) * Hidden + k] += d_hidden;
+            for (int f = 0; f < n; ++f)
+                grad[size_t(features[f]) * Hidden + k] += d_hidden;
+        }
+    }
+
+    void clip() // Веса первого слоя в пределах Max_weight (аккумулятор int16), веса выхода — без ограничения
+    {
+        for (size_t p = 0; p < size_t(Features) * Hidden + Hidden; ++p)
+            net.w[p] = std::clamp(net.w[p], -Max_weight, Max_weight);
+    }
+
+    void quantize(Nnue<Size> &out)   // Перенос весов в целочисленный формат Nnue
+    {
+        for (int f = 0; f < Features; ++f)
+            for (int k = 0; k < Hidden; ++k)
+                out.feature_weight(f, k) = int16_t(std::lround(net.feature(f, k) * Unit));
+        float max_output = 1e-6f;
+        for (int k = 0; k < Hidden; ++k)
+        {
+            out.bias(k) = int16_t(std::lround(net.bias(k) * Unit));
+            max_output = std::max(max_output, std::abs(net.output(k)));
+        }
+        const float output_unit = 127 / max_output; // Наибольший по модулю вес выхода становится +-127
+        for (int k = 0; k < Hidden; ++k)
+            out.output_weight(k) = int8_t(std::lround(net.output(k) * output_unit));
+        out.output_scale() = Unit * output_unit;    // Выход Nnue — сумма (нейрон * 127) * (вес * output_unit)
+        out.output_bias() = int32_t(std::lround(net.output_bias() * out.output_scale()));
+    }
+
+    template <class Func> void parallel(const size_t count, Func func)  // Делит [0, count) на Nnue.Threads частей и обрабатывает их параллельно
+    {
+        std::vector<std::thread> threads;
+        const size_t chunk = (count + threads_count - 1) / threads_count;
+        for (int t = 0; t < threads_count; ++t)
+        {
+            const size_t from = std::min(count, t * chunk), to = std::min(count, from + chunk);
+            if (from < to)
+                threads.emplace_back(func, t, from, to);
+        }
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+    void report(const std::string &stage, const double mse) const  // Прогресс обучения в лог и на консоль
+    {
+        Logger::instance().info("Nnue train " + stage, {{"mse", mse}});
+        std::cout << stage << ": mse " << mse << std::endl;
+    }
+
+  private:
+    Config *config; // Конфигурация (раздел Nnue)
+    int threads_count = 1;  // Потоков подсчёта градиента
+    network net;    // Обучаемые веса
+    Training_reader<Size> reader;   // Файл Nnue.DataFile
+    size_t used = 0;    // Позиций, пригодных для обучения
+};
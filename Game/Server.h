@@ -0,0 +1,453 @@
+#pragma once
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "../Models/Project_path.h"
+#include "Config.h"
+#include "Logger.h"
+#include "Logic.h"
+#include "Solver.h"
+#include "Trace.h"
+#include "Transposition_table.h"
+
+// Локальный сервер анализа: один "прогретый" движок на много клиентов.
+// Протокол — строки JSON через Unix-сокет или TCP на 127.0.0.1:
+//   {"cmd": "analyze", "id": 1, "board": [[0, 2, ...], ...], "color": 1, "depth": 8, "time_ms": 1000, "multipv": 3}
+//   {"cmd": "solve", "id": 1, "board": [[0, 2, ...], ...], "color": 1, "time_ms": 1000}
+//   {"cmd": "cancel", "id": 1}
+// Ответы: {"id": 1, "type": "info", "depth": ..., "score": ..., "moves": [[x, y, x2, y2, xb, yb], ...],
+//          "lines": [{"score": ..., "moves": [...], "pv": [...]}, ...], ...}
+// после каждой завершённой глубины (lines — лучшие multipv ходов по убыванию оценки), затем {"id": 1, "type": "done", "cancelled": false}.
+// На solve — {"id": 1, "type": "solved", "result": "win" | "loss" | "draw" | "unknown", "line": [[[x, y, x2, y2, xb, yb], ...], ...],
+//          "nodes": ..., "time_ms": ..., "cached": false} (результат — для стороны color, line — доказывающий вариант), затем done.
+// Если очередь заданий заполнена, запрос отклоняется ответом {"type": "error", "error": "busy"}, а запрос с id задания
+// этого клиента, которое ещё не завершено, — ответом {"type": "error", "error": "duplicate id"}.
+template <class Rules>
+class Server
+{
+  public:
+    typedef typename Logic<Rules>::board_mtx board_mtx;
+
+    explicit Server(Config *config)
+        : config(config), table((*config)("Server", "HashMB")), queue_size((*config)("Server", "QueueSize"))
+    {
+        const std::string cache_file = (*config)("Solver", "CacheFile");
+        std::string error;
+        if (!cache_file.empty() && !solved.open(project_path + cache_file, Rules::Size, Logic<Rules>::rules_version(), error))
+            Logger::instance().error("Solver cache error: " + error);
+        const int workers_count = (*config)("Server", "Workers");
+        for (int i = 0; i < std::max(1, workers_count); ++i)  // Движки создаются заранее: каждому потоку свой Logic, таблица общая
+        {
+            engines.emplace_back(new Logic<Rules>(nullptr, config));
+            engines.back()->set_table(&table);
+        }
+        const std::string table_file = (*config)("Cache", "File");    // Постоянная таблица позиций: общая с другими процессами
+        if (!table_file.empty() && !table.open(project_path + table_file, (*config)("Cache", "HashMB"), engines.front()->eval_version(), error))
+            Logger::instance().error("Position cache error: " + error + ", using in-memory table");
+    }
+
+    int run()   // Принимает подключения до SIGINT/SIGTERM; возвращает 0 при штатной остановке
+    {
+        const int listen_fd = open_socket();
+        if (listen_fd < 0)
+            return 1;
+        std::signal(SIGPIPE, SIG_IGN);
+        std::signal(SIGINT, on_signal);
+        std::signal(SIGTERM, on_signal);
+        for (auto &engine : engines)
+            workers.emplace_back(&Server::worker_loop, this, engine.get());
+
+        pollfd pfd{listen_fd, POLLIN, 0};
+        const std::chrono::seconds flush_period(int((*config)("Cache", "FlushSeconds")));
+        auto flushed = std::chrono::steady_clock::now();
+        while (!stop_requested())
+        {
+            if (std::chrono::steady_clock::now() - flushed >= flush_period)    // Периодическое сохранение таблицы позиций на диск
+            {
+                table.flush();
+                flushed = std::chrono::steady_clock::now();
+            }
+            if (poll(&pfd, 1, 200) <= 0)
+                continue;
+            const int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd < 0)
+                continue;
+            auto conn = std::make_shared<connection>(fd);
+            std::lock_guard<std::mutex> lock(mutex);
+            reap_readers();
+            readers.emplace_back();
+            readers.back().finished = std::make_shared<std::atomic<bool>>(false);
+            readers.back().thread = std::thread(&Server::reader_loop, this, conn, readers.back().finished);
+        }
+
+        close(listen_fd);
+        if (!socket_path.empty())
+            unlink(socket_path.c_str());
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto &conn_jobs : running)
+                for (auto &job_flag : conn_jobs.second)
+                    job_flag.second->store(true);
+            shutting_down = true;
+        }
+        jobs_cv.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+        for (auto &reader : readers)
+            reader.thread.join();
+        table.flush();
+        Logger::instance().info("Server stopped");
+        return 0;
+    }
+
+  private:
+    struct connection   // Клиентское подключение; запись защищена мьютексом, так как ответы идут из разных рабочих потоков
+    {
+        explicit connection(const int fd) : fd(fd)
+        {
+        }
+        ~connection()
+        {
+            close(fd);
+        }
+
+        void send(const json &message)
+        {
+            const std::string line = message.dump() + '\n';
+            std::lock_guard<std::mutex> lock(write_mutex);
+            size_t sent = 0;
+            while (sent < line.size())
+            {
+                const ssize_t n = ::send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0)
+                    return;
+                sent += n;
+            }
+        }
+
+        int fd;
+        std::mutex write_mutex;
+    };
+
+    struct reader   // Поток чтения подключения; finished — поток закончил работу и его можно присоединить
+    {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> finished;
+    };
+
+    struct job  // Задание на анализ
+    {
+        std::shared_ptr<connection> conn;
+        json id;
+        board_mtx mtx;
+        bool color = false;
+        int max_depth = 0;
+        int time_ms = 0;
+        size_t multipv = 1;
+        bool solve = false; // Решить позицию решателем эндшпилей вместо анализа
+        std::shared_ptr<std::atomic<bool>> cancel;
+    };
+
+    static std::atomic<bool> &stop_flag()
+    {
+        static std::atomic<bool> flag{false};
+        return flag;
+    }
+
+    static void on_signal(int)
+    {
+        stop_flag().store(true);
+    }
+
+    static bool stop_requested()
+    {
+        return stop_flag().load();
+    }
+
+    int open_socket()   // Открывает Unix-сокет (Server.Socket) или TCP-порт на 127.0.0.1 (Server.Port)
+    {
+        const std::string socket_name = (*config)("Server", "Socket");
+        int fd;
+        if (!socket_name.empty())
+        {
+            socket_path = project_path + socket_name;
+            unlink(socket_path.c_str());
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+            if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+                return socket_error(fd, "can't bind unix socket " + socket_path);
+        }
+        else
+        {
+            const int port = (*config)("Server", "Port");
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            const int yes = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+                return socket_error(fd, "can't bind 127.0.0.1:" + std::to_string(port));
+        }
+        if (listen(fd, 64) < 0)
+            return socket_error(fd, "can't listen");
+        Logger::instance().info("Server listening", {{"socket", socket_path}, {"workers", engines.size()},
+                                                     {"queue", queue_size}, {"hash_entries", table.size()}});
+        return fd;
+    }
+
+    int socket_error(const int fd, const std::string &text)
+    {
+        Logger::instance().error("Server error: " + text + ". " + std::strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    void reap_readers() // Присоединяет потоки отключившихся клиентов (под mutex), чтобы их число не росло за время работы сервера
+    {
+        for (auto it = readers.begin(); it != readers.end();)
+        {
+            if (!it->finished->load())
+            {
+                ++it;
+                continue;
+            }
+            it->thread.join();
+            it = readers.erase(it);
+        }
+    }
+
+    void reader_loop(std::shared_ptr<connection> conn, std::shared_ptr<std::atomic<bool>> finished)   // Читает запросы клиента построчно до отключения
+    {
+        TRACE_THREAD_NAME("reader");
+        std::string buffer;
+        char chunk[4096];
+        pollfd pfd{conn->fd, POLLIN, 0};
+        while (!stop_requested())
+        {
+            if (poll(&pfd, 1, 200) <= 0)
+                continue;
+            const ssize_t n = recv(conn->fd, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+                break;
+            buffer.append(chunk, n);
+            size_t pos;
+            while ((pos = buffer.find('\n')) != std::string::npos)
+            {
+                const std::string line = buffer.substr(0, pos);
+                buffer.erase(0, pos + 1);
+                if (line.empty())
+                    continue;
+                try
+                {
+                    handle(conn, line);
+                }
+                catch (const json::exception &e)    // Поле запроса неверного типа
+                {
+                    conn->send({{"type", "error"}, {"error", e.what()}});
+                }
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);  // Клиент отключился: отменяем его задания
+            for (auto &job_flag : running[conn.get()])
+                job_flag.second->store(true);
+            running.erase(conn.get());
+        }
+        finished->store(true);
+    }
+
+    void handle(const std::shared_ptr<connection> &conn, const std::string &line)   // Разбор одного запроса
+    {
+        json request = json::parse(line, nullptr, false);
+        if (request.is_discarded() || !request.is_object())
+            return conn->send({{"type", "error"}, {"error", "invalid json"}});
+        const json id = request.value("id", json());
+        const std::string cmd = request.value("cmd", "");
+        if (cmd == "cancel")
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto &conn_jobs = running[conn.get()];
+            auto it = conn_jobs.find(id.dump());
+            if (it != conn_jobs.end())
+                it->second->store(true);
+            return;
+        }
+        if (cmd != "analyze" && cmd != "solve")
+            return conn->send({{"id", id}, {"type", "error"}, {"error", "unknown cmd"}});
+
+        job task;
+        task.conn = conn;
+        task.id = id;
+        task.color = request.value("color", 0) != 0;
+        task.max_depth = std::max(0, request.value("depth", 6) - 1);
+        task.time_ms = request.value("time_ms", 0);
+        task.multipv = size_t(std::max(1, request.value("multipv", 1)));
+        task.solve = (cmd == "solve");
+        const json &board = request["board"];
+        if (!board.is_array() || board.size() != size_t(Rules::Size))
+            return conn->send({{"id", id}, {"type", "error"}, {"error", "board must be " + std::to_string(Rules::Size) + " rows"}});
+        int pieces[2] = {0, 0}; // Чёрных и белых
+        for (POS_T i = 0; i < Rules::Size; ++i)
+        {
+            if (!board[i].is_array() || board[i].size() != size_t(Rules::Size))
+                return conn->send({{"id", id}, {"type", "error"}, {"error", "invalid board row"}});
+            for (POS_T j = 0; j < Rules::Size; ++j)
+            {
+                const int piece = board[i][j].get<int>();
+                if (piece < 0 || piece > 4 || (piece && (i + j) % 2 == 0))
+                    return conn->send({{"id", id}, {"type", "error"}, {"error", "invalid piece"}});
+                task.mtx[i][j] = POS_T(piece);
+                pieces[piece % 2] += (piece != 0);
+            }
+        }
+        if (std::max(pieces[0], pieces[1]) > move_series<Rules::Size>::Max_hops)  // Больше шашек, чем в начале партии
+            return conn->send({{"id", id}, {"type", "error"}, {"error", "too many pieces"}});
+        task.cancel = std::make_shared<std::atomic<bool>>(false);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (shutting_down)  // Рабочие потоки уже выходят: задание некому выполнить
+                return conn->send({{"id", id}, {"type", "error"}, {"error", "shutting down"}});
+            if (jobs.size() >= queue_size)  // Обратное давление: не копим задания сверх лимита
+                return conn->send({{"id", id}, {"type", "error"}, {"error", "busy"}});
+            auto &conn_jobs = running[conn.get()];
+            if (conn_jobs.count(id.dump()))   // Иначе cancel по этому id не смог бы остановить первое задание
+                return conn->send({{"id", id}, {"type", "error"}, {"error", "duplicate id"}});
+            conn_jobs[id.dump()] = task.cancel;
+            jobs.push_back(std::move(task));
+        }
+        jobs_cv.notify_one();
+    }
+
+    void worker_loop(Logic<Rules> *logic)   // Рабочий поток: итеративное углубление по заданию с отправкой результата каждой глубины
+    {
+        std::unique_ptr<Solver<Rules>> solver;  // Решатель потока создаётся при первом задании solve (его таблица — Solver.HashMB)
+        TRACE_THREAD_NAME("worker");
+        while (true)
+        {
+            job task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobs_cv.wait(lock, [this] { return shutting_down || !jobs.empty(); });
+                if (shutting_down)  // Задания из очереди не начинаются, но клиенты получают по ним done (иначе — только обрыв связи)
+                {
+                    std::deque<job> left;
+                    left.swap(jobs);
+                    lock.unlock();
+                    for (const job &rest : left)
+                        finish_job(rest, rest.solve ? json{{"id", rest.id}, {"type", "done"}, {"cancelled", true}}
+                                                    : json{{"id", rest.id}, {"type", "done"}, {"depth", 0}, {"cancelled", true}});
+                    return;
+                }
+                task = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            if (task.solve)
+            {
+                if (!solver)
+                    solver = std::make_unique<Solver<Rules>>(config, &solved);
+                TRACE_ZONE("server", "solve");
+                solve_job(task, *solver);
+                finish_job(task, {{"id", task.id}, {"type", "done"}, {"cancelled", task.cancel->load()}});
+                continue;
+            }
+            TRACE_ZONE("server", "analyze");
+            const auto start = std::chrono::steady_clock::now();
+            logic->set_limits(task.cancel.get(), task.time_ms > 0 ? start + std::chrono::milliseconds(task.time_ms)
+                                                                  : std::chrono::steady_clock::time_point());
+            int depth_done = 0;
+            for (int depth = 0; depth <= task.max_depth && !task.cancel->load(); ++depth)
+            {
+                logic->Max_depth = depth;
+                const auto lines = logic->find_best_lines(task.mtx, task.color, task.multipv);
+                if (logic->aborted())
+                    break;
+                const search_stats &stats = logic->last_stats();
+                json info = {{"id", task.id}, {"type", "info"}, {"depth", depth + 1}, {"score", stats.score},
+                             {"nodes", stats.nodes}, {"nps", stats.nps()}, {"hash_hits", stats.hash_hits},
+                             {"time_ms", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()}};
+                info["moves"] = (lines.empty() ? json::array() : to_json_moves(lines.front().turn));
+                info["lines"] = json::array();
+                for (const auto &line : lines)
+                    info["lines"].push_back({{"score", line.score}, {"moves", to_json_moves(line.turn)}, {"pv", to_json_moves(line.pv)}});
+                task.conn->send(info);
+                depth_done = depth + 1;
+                if (lines.empty())  // Ходов нет — углублять нечего
+                    break;
+            }
+            finish_job(task, {{"id", task.id}, {"type", "done"}, {"depth", depth_done}, {"cancelled", task.cancel->load()}});
+        }
+    }
+
+    void solve_job(const job &task, Solver<Rules> &solver)  // Задание solve: результат решателя и доказывающий вариант
+    {
+        solver.set_limits(task.cancel.get(), task.time_ms > 0 ? std::chrono::steady_clock::now() + std::chrono::milliseconds(task.time_ms)
+                                                              : std::chrono::steady_clock::time_point());
+        const solution res = solver.solve(task.mtx, task.color);
+        static const char *const results[] = {"unknown", "win", "loss", "draw"};
+        json line = json::array();
+        for (const auto &turn : res.line)
+            line.push_back(to_json_moves(turn));
+        task.conn->send({{"id", task.id}, {"type", "solved"}, {"result", results[int(res.result)]}, {"line", line},
+                         {"nodes", res.nodes}, {"time_ms", res.time_ms}, {"cached", res.cached}});
+    }
+
+    // Задание выполнено: его флаг отмены больше не нужен. Ответ done отправляется после этого, так что клиент,
+    // получивший done, может сразу использовать тот же id
+    void finish_job(const job &task, const json &done)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = running.find(task.conn.get());
+            if (it != running.end())
+                it->second.erase(task.id.dump());
+        }
+        task.conn->send(done);
+    }
+
+    static json to_json_moves(const std::vector<move_pos> &moves)  // Ходы в виде [[x, y, x2, y2, xb, yb], ...]
+    {
+        json res = json::array();
+        for (const auto &turn : moves)
+            res.push_back({turn.x, turn.y, turn.x2, turn.y2, turn.xb, turn.yb});
+        return res;
+    }
+
+  private:
+    Config *config; // Конфигурация (раздел Server)
+    Transposition_table table;  // Общая таблица транспозиций всех рабочих потоков
+    Solved_cache solved;    // Общий кэш решённых позиций (Solver.CacheFile)
+    size_t queue_size;  // Максимальное количество ожидающих заданий
+    std::vector<std::unique_ptr<Logic<Rules>>> engines; // Движки рабочих потоков
+    std::vector<std::thread> workers;   // Рабочие потоки
+    std::vector<reader> readers;    // Потоки чтения клиентских подключений (закончившиеся присоединяются при следующем подключении)
+    std::mutex mutex;   // Защищает jobs, running, readers и shutting_down
+    std::condition_variable jobs_cv;    // Сигнал о новых заданиях
+    std::deque<job> jobs;   // Очередь заданий
+    std::map<connection *, std::map<std::string, std::shared_ptr<std::atomic<bool>>>> running;  // Флаги отмены заданий по клиенту и id
+    bool shutting_down = false; // Сервер останавливается
+    std::string socket_path;    // Путь к Unix-сокету (пустой для TCP)
+};
+#endif
@@ -0,0 +1,534 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Models/Solution.h"
+#include "Config.h"
+#include "Game_database.h"
+#include "Logic.h"
+
+struct solved_position  // Решённая позиция: результат для стороны, которая ходит, и лучший ход
+{
+    Solve_result result = Solve_result::UNKNOWN;
+    uint8_t from = 255, to = 255;   // Номера тёмных клеток начала и конца хода (255 — хода нет)
+    uint64_t captured = 0;  // Взятые шашки (бит king_rays::square): серии дамки с одним началом и концом различаются только ими
+};
+
+// Кэш решённых позиций: ключ позиции (Logic::history_key) -> результат и лучший ход. Результат — для позиции без истории
+// (сразу после необратимого хода: счётчик ходов дамками 0, повторений нет). Хранится в памяти и, если открыт
+// файл, дописывается в него: "CKSV", uint32 версия, uint32 размер доски, uint32 резерв, uint64 хэш правил, затем записи
+// по 24 байта {uint64 ключ, uint64 взятые шашки, uint8 результат, uint8 откуда, uint8 куда}. Записи только добавляются,
+// поэтому файл общий для партий и процессов.
+class Solved_cache
+{
+  public:
+    Solved_cache() = default;
+    Solved_cache(const Solved_cache &) = delete;
+    Solved_cache &operator=(const Solved_cache &) = delete;
+
+    ~Solved_cache()
+    {
+        if (file)
+            std::fclose(file);
+    }
+
+    // Загружает решённые позиции и открывает файл на дозапись; rules — Logic::rules_version (варианты 8x8 различаются)
+    bool open(const std::string &path, const POS_T size, const uint64_t rules, std::string &error)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        header expected;
+        expected.board_size = size;
+        expected.rules = rules;
+        file = std::fopen(path.c_str(), "ab+");
+        if (!file)
+        {
+            error = "can't open " + path;
+            return false;
+        }
+        std::fseek(file, 0, SEEK_END);
+        if (std::ftell(file) == 0)
+        {
+            std::fwrite(&expected, sizeof(expected), 1, file);
+            std::fflush(file);
+            return true;
+        }
+        header existing;
+        std::fseek(file, 0, SEEK_SET);
+        if (std::fread(&existing, sizeof(existing), 1, file) != 1 || std::memcmp(&existing, &expected, sizeof(expected)) != 0)
+        {
+            error = path + " is a solved positions file of other format, board size or rules";
+            std::fclose(file);
+            file = nullptr;
+            return false;
+        }
+        record r;
+        while (std::fread(&r, sizeof(r), 1, file) == 1)
+            positions[r.key] = solved_position{Solve_result(r.result), r.from, r.to, r.captured};
+        std::fseek(file, 0, SEEK_END);
+        return true;
+    }
+
+    bool is_open() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return file != nullptr;
+    }
+
+    bool find(const uint64_t key, solved_position &position) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = positions.find(key);
+        if (it == positions.end())
+            return false;
+        position = it->second;
+        return true;
+    }
+
+    void add(const uint64_t key, const solved_position &position)  // Новый результат: в память и в конец файла
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!positions.emplace(key, position).second)
+            return;
+        if (file)
+        {
+            record r;
+            r.key = key;
+            r.result = uint8_t(position.result);
+            r.from = position.from;
+            r.to = position.to;
+            r.captured = position.captured;
+            std::fwrite(&r, sizeof(r), 1, file);
+            std::fflush(file);
+        }
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return positions.size();
+    }
+
+  private:
+    struct header
+    {
+        char magic[4] = {'C', 'K', 'S', 'V'};
+        uint32_t version = 3;   // Версия 1 хранила результаты, доказанные с историей партии; версия 2 — ход без взятых шашек и без хэша правил
+        uint32_t board_size = 0;
+        uint32_t reserved = 0;
+        uint64_t rules = 0; // Logic::rules_version (русские, английские и бразильские шашки — все 8x8)
+    };
+    struct record
+    {
+        uint64_t key = 0;
+        uint64_t captured = 0;
+        uint8_t result = 0;
+        uint8_t from = 255, to = 255;
+        uint8_t reserved[5] = {};
+    };
+
+    mutable std::mutex mutex;   // Кэш общий для рабочих потоков сервера
+    std::unordered_map<uint64_t, solved_position> positions;
+    std::FILE *file = nullptr;  // Файл кэша (nullptr — только в памяти)
+};
+
+// Решатель эндшпилей: поиск по числам доказательства в глубину (df-pn) без ограничения глубины.
+// Позиция решается двумя булевыми поисками: "выигрывает сторона, которая ходит" и, если это опровергнуто,
+// "выигрывает соперник"; если опровергнуты оба — ничья. Ничья по правилам (повторение, лимит ходов дамками)
+// считается неудачей нападающего. Числа узлов хранятся в таблице фиксированного размера (Solver.HashMB,
+// корзины по 2 записи, вытесняется запись с меньшим поддеревом), поэтому память не растёт с числом узлов.
+// Ничья по правилам зависит от пути, поэтому ключ таблицы — не позиция, а весь путь с последнего необратимого хода
+// (от него зависят и повторения, и счётчик ходов дамками): числа узла не переносятся на тот же узел с другой историей.
+template <class Rules>
+class Solver
+{
+  public:
+    typedef typename Logic<Rules>::board_mtx board_mtx;
+    static constexpr size_t Max_line = 200;    // Ограничение длины доказывающего варианта
+
+    explicit Solver(Config *config, Solved_cache *cache = nullptr) : logic(nullptr, config), cache(cache)
+    {
+        const size_t bytes = size_t(std::max(1, int((*config)("Solver", "HashMB")))) << 20;
+        size_t count = 1;
+        while (count * 2 * sizeof(bucket) <= bytes)
+            count *= 2;
+        table.resize(count);
+        max_nodes = (*config)("Solver", "MaxNodes");
+    }
+
+    void set_limits(const std::atomic<bool> *stop_flag, const std::chrono::steady_clock::time_point stop_time = {})  // Внешний флаг отмены и крайний срок
+    {
+        stop = stop_flag;
+        deadline = stop_time;
+    }
+
+    // Решение позиции; history — ключи позиций партии с последнего необратимого хода (как Logic::set_history)
+    solution solve(const board_mtx &mtx, const bool color, std::vector<uint64_t> history = {})
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const uint64_t root_key = logic.history_key(mtx, color);
+        if (history.empty() || history.back() != root_key)
+            history.assign(1, root_key);
+        nodes = 0;
+        stopped = false;
+        solution res;
+        solved_position known;
+        // Кэш хранит результаты для позиции без истории; с историей ничьих по правилам только больше, поэтому
+        // выигрыш и проигрыш из кэша годятся лишь без истории, а ничья — всегда
+        if (cache && cache->find(root_key, known) && known.result != Solve_result::UNKNOWN &&
+            (history.size() == 1 || known.result == Solve_result::DRAW))
+        {
+            res.result = known.result;
+            res.line = cached_line(mtx, color);
+            res.cached = true;
+        }
+        else
+        {
+            res.result = prove(mtx, color, history, res.line);
+            remember(mtx, color, history.size() == 1, res);
+        }
+        res.nodes = nodes;
+        res.time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return res;
+    }
+
+  private:
+    static constexpr uint32_t Infinity = 1u << 30;  // Число доказательства решённого узла
+    static constexpr uint64_t History_salt = 0xD6E8FEB86659FD93ULL;   // Отличие позиций истории партии в ключе пути
+
+    struct numbers  // Числа доказательства (pn) и опровержения (dn) утверждения "нападающий выигрывает"
+    {
+        uint32_t pn = 1, dn = 1;
+    };
+
+    struct entry
+    {
+        uint64_t key = 0;
+        numbers n;
+        uint64_t work = 0;  // Узлов в поддереве (для вытеснения и выбора варианта)
+    };
+
+    struct bucket
+    {
+        entry slots[2];
+    };
+
+    struct child    // Ход узла и позиция после него
+    {
+        board_mtx mtx;
+        uint64_t key;
+        bool reversible;
+        numbers n;
+    };
+
+    struct path_step    // Позиция на стеке пути на время обхода хода (для правил ничьей)
+    {
+        path_step(Solver *solver, const uint64_t key, const bool reversible) : solver(solver), base(solver->path_base)
+        {
+            if (!reversible)
+                solver->path_base = solver->path.size();
+            solver->segments.push_back(extend(reversible ? solver->segments.back() : 0, key));
+            solver->path.push_back(key);
+        }
+        ~path_step()
+        {
+            solver->path.pop_back();
+            solver->segments.pop_back();
+            solver->path_base = base;
+        }
+        Solver *solver;
+        size_t base;
+    };
+
+    Solve_result prove(const board_mtx &mtx, const bool color, const std::vector<uint64_t> &history,
+                       std::vector<std::vector<move_pos>> &line)
+    {
+        numbers root = run(mtx, color, color, history);
+        if (root.pn == 0)
+        {
+            line = proving_line(mtx, color, history, true);
+            return Solve_result::WIN;
+        }
+        if (root.dn != 0)
+            return Solve_result::UNKNOWN;
+        root = run(mtx, color, !color, history);
+        if (root.pn == 0)
+        {
+            line = proving_line(mtx, color, history, true);
+            return Solve_result::LOSS;
+        }
+        if (root.dn == 0)
+        {
+            line = proving_line(mtx, color, history, false);
+            return Solve_result::DRAW;
+        }
+        return Solve_result::UNKNOWN;
+    }
+
+    numbers run(const board_mtx &mtx, const bool color, const bool attacker_color, const std::vector<uint64_t> &history)
+    {
+        attacker = attacker_color;
+        start_path(history);
+        return mid(mtx, color, {Infinity, Infinity});
+    }
+
+    void start_path(const std::vector<uint64_t> &history)  // Путь из истории партии (все её ходы обратимые)
+    {
+        path = history;
+        path_base = 0;
+        path_root = path.size() - 1;
+        segments.clear();
+        for (size_t i = 0; i < path.size(); ++i)    // Позиции истории до корня повторяются по правилам партии — отличаем их
+            segments.push_back(extend(i == 0 ? 0 : segments.back(), i < path_root ? path[i] ^ History_salt : path[i]));
+    }
+
+    static uint64_t extend(const uint64_t segment, const uint64_t key)  // Ключ пути с последнего необратимого хода, продлённого позицией key
+    {
+        uint64_t h = (segment ^ key) * 0x9E3779B97F4A7C15ULL;
+        return h ^ (h >> 29);
+    }
+
+    // Раскрытие узла (MID): перебирает самого перспективного потомка, пока числа узла не превысят пороги th
+    numbers mid(const board_mtx &mtx, const bool color, const numbers th)
+    {
+        const uint64_t key = entry_key(segments.back());
+        const uint64_t nodes_before = nodes++;
+        const entry known = lookup(key);
+        if (known.n.pn == 0 || known.n.dn == 0 || out_of_limits())  // Решённый узел не пересчитывается: ничья, найденная по другому пути, иначе затиралась бы
+            return known.n;
+        const auto turns = logic.legal_turns(mtx, color);
+        const bool attacker_moves = (color == attacker);
+        if (turns.empty())  // Нет ходов — проигрыш стороны, которая ходит
+        {
+            const numbers n = (attacker_moves ? numbers{Infinity, 0} : numbers{0, Infinity});
+            store(key, n, 1);
+            return n;
+        }
+        std::vector<child> children(turns.size());
+        for (size_t i = 0; i < turns.size(); ++i)
+        {
+            child &c = children[i];
+            c.mtx = logic.apply_turns(mtx, turns[i]);
+            c.key = logic.history_key(c.mtx, !color);
+            c.reversible = (turns[i].size() == 1 && Logic<Rules>::is_reversible(mtx, turns[i].front()));
+            path_step step(this, c.key, c.reversible);
+            c.n = (Logic<Rules>::draw_by_rules(path, path_base, path_root) ? numbers{Infinity, 0} : lookup(entry_key(segments.back())).n);
+        }
+        numbers n;
+        while (true)
+        {
+            size_t best = 0;
+            uint32_t second = Infinity, open = 0;
+            n = collect(children, attacker_moves, best, second, open);
+            if (n.pn >= th.pn || n.dn >= th.dn || stopped)
+                break;
+            numbers child_th;   // Порог потомка: превышение любого из них меняет числа узла так, что пора выбрать другого
+            if (attacker_moves)
+            {
+                child_th.pn = std::min(th.pn, second + 1);
+                child_th.dn = th.dn - (open - 1);
+            }
+            else
+            {
+                child_th.dn = std::min(th.dn, second + 1);
+                child_th.pn = th.pn - (open - 1);
+            }
+            child &c = children[best];
+            path_step step(this, c.key, c.reversible);
+            c.n = mid(c.mtx, !color, child_th);
+        }
+        store(key, n, nodes - nodes_before);
+        return n;
+    }
+
+    // Числа узла по потомкам: ход нападающего — pn = min, dn = "слабая сумма" dn; ход защиты — наоборот.
+    // Слабая сумма (максимум + число остальных нерешённых потомков) не раздувается на транспозициях, которых
+    // в эндшпиле дамок очень много, в отличие от обычной суммы. best — потомок для раскрытия, second — второй
+    // по величине минимум (для порога), open — число потомков с ненулевой суммируемой величиной
+    static numbers collect(const std::vector<child> &children, const bool attacker_moves, size_t &best, uint32_t &second, uint32_t &open)
+    {
+        uint32_t first = Infinity + 1, largest = 0;
+        open = 0;
+        for (size_t i = 0; i < children.size(); ++i)
+        {
+            const numbers &c = children[i].n;
+            const uint32_t value = (attacker_moves ? c.pn : c.dn);
+            const uint32_t summed = (attacker_moves ? c.dn : c.pn);
+            largest = std::max(largest, summed);
+            open += (summed != 0);
+            if (value < first)
+            {
+                second = std::min(second, first);
+                first = value;
+                best = i;
+            }
+            else
+                second = std::min(second, value);
+        }
+        const uint32_t sum = (largest == Infinity ? Infinity : open == 0 ? 0 : std::min(largest + open - 1, Infinity - 1));
+        return attacker_moves ? numbers{first, sum} : numbers{sum, first};
+    }
+
+    // Доказывающий вариант по таблице: потомки с pn = 0 (доказательство) или dn = 0 (опровержение — ничья).
+    // Сторона, за которую доказано, выбирает самое маленькое поддерево (быстрейший путь), другая — самое большое
+    std::vector<std::vector<move_pos>> proving_line(board_mtx mtx, bool color, const std::vector<uint64_t> &history, const bool proof)
+    {
+        std::vector<std::vector<move_pos>> line;
+        start_path(history);
+        while (line.size() < Max_line)
+        {
+            const auto turns = logic.legal_turns(mtx, color);
+            const bool minimize = ((color == attacker) == proof);
+            int chosen = -1;
+            uint64_t chosen_work = 0;
+            bool chosen_draw = false;
+            for (size_t i = 0; i < turns.size(); ++i)
+            {
+                const board_mtx next = logic.apply_turns(mtx, turns[i]);
+                const bool reversible = (turns[i].size() == 1 && Logic<Rules>::is_reversible(mtx, turns[i].front()));
+                path_step step(this, logic.history_key(next, !color), reversible);
+                const bool draw = Logic<Rules>::draw_by_rules(path, path_base, path_root);
+                entry e;
+                if (draw ? proof : !find(entry_key(segments.back()), e) || (proof ? e.n.pn : e.n.dn) != 0)
+                    continue;
+                const uint64_t work = (draw ? 0 : e.work);
+                if (chosen == -1 || (minimize ? work < chosen_work : work > chosen_work))
+                {
+                    chosen = int(i);
+                    chosen_work = work;
+                    chosen_draw = draw;
+                }
+            }
+            if (chosen == -1)
+                break;
+            const bool reversible = (turns[chosen].size() == 1 && Logic<Rules>::is_reversible(mtx, turns[chosen].front()));
+            line.push_back(turns[chosen]);
+            mtx = logic.apply_turns(mtx, turns[chosen]);
+            color = !color;
+            const uint64_t next_key = logic.history_key(mtx, color);
+            if (!reversible)
+                path_base = path.size();
+            segments.push_back(extend(reversible ? segments.back() : 0, next_key));
+            path.push_back(next_key);
+            if (chosen_draw)
+                break;
+        }
+        return line;
+    }
+
+    // Запись в кэш: только позиции без истории — корень, решённый без истории партии, и позиции варианта сразу после
+    // необратимого хода (их поддерево доказано с пустой историей). Ничья — только для корня
+    void remember(board_mtx mtx, bool color, const bool without_history, const solution &res)
+    {
+        if (!cache || res.result == Solve_result::UNKNOWN)
+            return;
+        Solve_result result = res.result;
+        bool fresh = without_history;
+        for (size_t i = 0; i <= res.line.size(); ++i)
+        {
+            solved_position position{result};
+            if (i < res.line.size())
+            {
+                const auto move = game_move<Rules::Size>::make(res.line[i]);
+                position.from = move.from;
+                position.to = move.to;
+                position.captured = move.captured;
+            }
+            if (fresh)
+                cache->add(logic.history_key(mtx, color), position);
+            if (i == res.line.size() || result == Solve_result::DRAW)
+                break;
+            fresh = !(res.line[i].size() == 1 && Logic<Rules>::is_reversible(mtx, res.line[i].front()));
+            mtx = logic.apply_turns(mtx, res.line[i]);
+            color = !color;
+            result = (result == Solve_result::WIN ? Solve_result::LOSS : Solve_result::WIN);
+        }
+    }
+
+    std::vector<std::vector<move_pos>> cached_line(board_mtx mtx, bool color)    // Вариант по лучшим ходам из кэша (до первой позиции, которой в нём нет)
+    {
+        std::vector<std::vector<move_pos>> line;
+        solved_position position;
+        while (line.size() < Max_line && cache->find(logic.history_key(mtx, color), position) && position.from != 255)
+        {
+            game_move<Rules::Size> move;
+            move.from = position.from;
+            move.to = position.to;
+            move.captured = position.captured;
+            const auto turns = logic.legal_turns(mtx, color);
+            auto it = std::find_if(turns.begin(), turns.end(), [&](const std::vector<move_pos> &turn) { return move.matches(turn); });
+            if (it == turns.end())
+                break;
+            line.push_back(*it);
+            mtx = logic.apply_turns(mtx, *it);
+            color = !color;
+        }
+        return line;
+    }
+
+    uint64_t entry_key(const uint64_t segment) const  // Ключ таблицы: путь с последнего необратимого хода и нападающая сторона
+    {
+        return segment ^ (attacker ? zobrist_key(Rules::Size * Rules::Size * 4 + 1) : 0);
+    }
+
+    bool find(const uint64_t key, entry &e) const
+    {
+        const bucket &b = table[key & (table.size() - 1)];
+        for (const entry &slot : b.slots)
+            if (slot.key == key)
+            {
+                e = slot;
+                return true;
+            }
+        return false;
+    }
+
+    entry lookup(const uint64_t key) const  // Запись таблицы или числа нераскрытого узла (1, 1)
+    {
+        entry e;
+        find(key, e);
+        return e;
+    }
+
+    void store(const uint64_t key, const numbers n, const uint64_t work)
+    {
+        bucket &b = table[key & (table.size() - 1)];
+        entry *slot = (b.slots[0].key == key || (b.slots[1].key != key && b.slots[0].work <= b.slots[1].work) ? &b.slots[0] : &b.slots[1]);
+        slot->key = key;
+        slot->n = n;
+        slot->work = work;
+    }
+
+    bool out_of_limits()    // Лимит узлов (Solver.MaxNodes), флаг отмены и крайний срок (время — раз в 1024 узла)
+    {
+        if (stopped)
+            return true;
+        if (nodes > max_nodes || (stop && stop->load(std::memory_order_relaxed)))
+            stopped = true;
+        else if (deadline != std::chrono::steady_clock::time_point() && (nodes & 1023) == 0 &&
+                 std::chrono::steady_clock::now() >= deadline)
+            stopped = true;
+        return stopped;
+    }
+
+  private:
+    Logic<Rules> logic; // Генератор ходов и ключи позиций
+    Solved_cache *cache;    // Кэш решённых позиций (не владеет, может отсутствовать)
+    std::vector<bucket> table;  // Таблица чисел доказательства
+    uint64_t max_nodes = 0; // Лимит раскрытых узлов на позицию
+    uint64_t nodes = 0; // Раскрыто узлов в текущем решении
+    bool stopped = false;   // Решение прервано по лимиту
+    const std::atomic<bool> *stop = nullptr;    // Внешний флаг отмены
+    std::chrono::steady_clock::time_point deadline; // Крайний срок (пустой — без ограничения)
+    bool attacker = false;  // Сторона, выигрыш которой доказывается
+    std::vector<uint64_t> path; // Ключи позиций: история партии и текущий путь
+    std::vector<uint64_t> segments; // Ключи путей: для каждой позиции path — путь до неё с последнего необратимого хода
+    size_t path_base = 0;   // Первая позиция path после последнего необратимого хода
+    size_t path_root = 0;   // Позиция корня в path
+};
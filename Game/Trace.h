@@ -0,0 +1,181 @@
+#pragma once
+// Профилирование по зонам: TRACE_ZONE("категория", "имя") измеряет время до конца текущего блока и кладёт событие
+// в буфер своего потока (без блокировок), TRACE_DUMP(путь) сохраняет буферы всех потоков в JSON формата
+// Chrome trace event (открывается в https://ui.perfetto.dev или chrome://tracing).
+// Трассировка включается сборкой с -DCHECKERS_TRACE; без него макросы пустые и в код не попадают.
+#ifdef CHECKERS_TRACE
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct trace_event
+{
+    const char *category;   // Категория (строковый литерал)
+    const char *name;       // Имя зоны (строковый литерал)
+    const char *arg_name;   // Имя числового аргумента или nullptr
+    int64_t arg;            // Значение аргумента (например, глубина поиска)
+    int64_t start_ns;       // Начало от запуска программы
+    int64_t duration_ns;    // Длительность
+};
+
+// Трассировщик: у каждого потока свой буфер фиксированного размера, который пишет только этот поток;
+// число записанных событий публикуется атомарно, поэтому выгрузка может идти параллельно с записью.
+// Буферы принадлежат трассировщику и переживают свои потоки: буфер закончившегося потока достаётся следующему новому
+// потоку (его события продолжают ту же дорожку трассы), поэтому буферов не больше, чем потоков, работавших одновременно,
+// — сервер, который создаёт поток на каждого клиента, не растёт на 3 МБ за клиента. Переполненный буфер отбрасывает события.
+class Tracer
+{
+  public:
+    static constexpr size_t Buffer_events = 1 << 16;    // Событий на поток (около 3 МБ)
+
+    static Tracer &instance()
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    static int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - instance().origin).count();
+    }
+
+    void record(const trace_event &event)
+    {
+        buffer &b = thread_buffer();
+        const size_t n = b.count.load(std::memory_order_relaxed);
+        if (n == Buffer_events)
+        {
+            b.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        b.events[n] = event;
+        b.count.store(n + 1, std::memory_order_release);
+    }
+
+    void set_thread_name(const std::string &name)   // Имя текущего потока в просмотрщике
+    {
+        buffer &b = thread_buffer();
+        std::lock_guard<std::mutex> lock(mutex);
+        b.name = name;
+    }
+
+    bool dump(const std::string &path)  // Запись событий всех потоков в JSON (Chrome trace event format)
+    {
+        std::ofstream fout(path, std::ios_base::trunc);
+        fout << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &b : buffers)
+        {
+            fout << (first ? "" : ",") << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << b->tid
+                 << ",\"args\":{\"name\":\"" << b->name << "\"}}";
+            first = false;
+            const size_t n = b->count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < n; ++i)
+            {
+                const trace_event &e = b->events[i];
+                fout << ",\n{\"ph\":\"X\",\"cat\":\"" << e.category << "\",\"name\":\"" << e.name << "\",\"pid\":1,\"tid\":" << b->tid
+                     << ",\"ts\":" << e.start_ns / 1000.0 << ",\"dur\":" << e.duration_ns / 1000.0;
+                if (e.arg_name)
+                    fout << ",\"args\":{\"" << e.arg_name << "\":" << e.arg << "}";
+                fout << "}";
+            }
+            if (const size_t dropped = b->dropped.load(std::memory_order_relaxed))  // Метка: буфер потока переполнился
+                fout << ",\n{\"ph\":\"i\",\"s\":\"t\",\"name\":\"dropped " << dropped << " events\",\"pid\":1,\"tid\":" << b->tid
+                     << ",\"ts\":" << (n ? (b->events[n - 1].start_ns + b->events[n - 1].duration_ns) / 1000.0 : 0.0) << "}";
+        }
+        fout << "\n]}\n";
+        return bool(fout);
+    }
+
+  private:
+    struct buffer
+    {
+        std::unique_ptr<trace_event[]> events{new trace_event[Buffer_events]};
+        std::atomic<size_t> count{0};   // Записанные события (публикуются с release)
+        std::atomic<size_t> dropped{0}; // События, не поместившиеся в буфер
+        std::atomic<bool> in_use{true}; // Буфер занят живым потоком
+        int tid = 0;                    // Номер потока в трассе
+        std::string name;               // Имя потока
+    };
+
+    struct buffer_owner // Буфер потока: при завершении потока освобождается для следующего
+    {
+        ~buffer_owner()
+        {
+            if (own)
+                own->in_use.store(false, std::memory_order_release);
+        }
+        buffer *own = nullptr;
+    };
+
+    Tracer() : origin(std::chrono::steady_clock::now())
+    {
+    }
+
+    buffer &thread_buffer() // Буфер текущего потока (при первом событии потока — свободный буфер или новый)
+    {
+        thread_local buffer_owner owner;
+        if (!owner.own)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto &b : buffers)
+                if (!b->in_use.load(std::memory_order_acquire))
+                {
+                    owner.own = b.get();
+                    owner.own->in_use.store(true, std::memory_order_relaxed);
+                    break;
+                }
+            if (!owner.own)
+            {
+                buffers.emplace_back(new buffer());
+                owner.own = buffers.back().get();
+                owner.own->tid = int(buffers.size());
+            }
+            owner.own->name = "thread " + std::to_string(owner.own->tid);
+        }
+        return *owner.own;
+    }
+
+    std::chrono::steady_clock::time_point origin;   // Начало отсчёта времени событий
+    std::mutex mutex;   // Защищает список буферов и имена потоков
+    std::vector<std::unique_ptr<buffer>> buffers;   // Буферы всех потоков, писавших события
+};
+
+class Trace_zone    // Зона: событие от конструктора до деструктора
+{
+  public:
+    Trace_zone(const char *category, const char *name, const char *arg_name = nullptr, const int64_t arg = 0)
+        : event{category, name, arg_name, arg, Tracer::now_ns(), 0}
+    {
+    }
+    ~Trace_zone()
+    {
+        event.duration_ns = Tracer::now_ns() - event.start_ns;
+        Tracer::instance().record(event);
+    }
+
+    Trace_zone(const Trace_zone &) = delete;
+    Trace_zone &operator=(const Trace_zone &) = delete;
+
+  private:
+    trace_event event;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(category, name) Trace_zone TRACE_CONCAT(trace_zone_, __LINE__)(category, name)
+#define TRACE_ZONE_ARG(category, name, arg_name, arg) Trace_zone TRACE_CONCAT(trace_zone_, __LINE__)(category, name, arg_name, int64_t(arg))
+#define TRACE_THREAD_NAME(name) Tracer::instance().set_thread_name(name)
+#define TRACE_DUMP(path) Tracer::instance().dump(path)
+#else
+#define TRACE_ZONE(category, name) ((void)0)
+#define TRACE_ZONE_ARG(category, name, arg_name, arg) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#define TRACE_DUMP(path) ((void)0)
+#endif
@@ -0,0 +1,347 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../Models/Move.h"
+#include "Mapped_file.h"
+
+// Обучающие данные: позиции, которые бот считал в партиях, в упакованном виде.
+// Файл: заголовок (magic "CKTD", версия, размер доски, размер записи, хэш правил) и записи фиксированного размера подряд,
+// поэтому N-я запись читается по смещению без разбора файла, а файл дописывается без перезаписи.
+
+enum class Game_result : uint8_t
+{
+    UNKNOWN,    // Партия не закончена
+    WHITE,      // Победа белых
+    BLACK,      // Победа чёрных
+    DRAW        // Ничья
+};
+
+template <POS_T Size>
+struct training_record  // 16 байт для 8x8 (3 x 32 бита доски + оценка + ход/очередь/результат), 32 байта для 10x10 (с выравниванием)
+{
+    typedef std::conditional_t<(Size * Size / 2 <= 32), uint32_t, uint64_t> bits_t;   // Бит на тёмную клетку
+    static constexpr int Squares = Size * Size / 2;
+
+    bits_t white = 0;       // Белые шашки и дамки
+    bits_t black = 0;       // Чёрные шашки и дамки
+    bits_t kings = 0;       // Дамки обоих цветов
+    int16_t score = 0;      // Оценка поиска для стороны, которая ходит: ln(отношение) * 1024 (+-32767 — выигрыш/проигрыш)
+    uint16_t info = 0;      // Биты 0-5 — откуда, 6-11 — куда (номера тёмных клеток), 12 — очередь (1 — чёрные), 13-14 — результат, 15 — ход со взятием
+
+    template <class Mtx> static training_record make(const Mtx &mtx, const bool color, const double search_score, const move_pos &turn)
+    {
+        training_record r;
+        for (POS_T i = 0; i < Size; ++i)
+            for (POS_T j = (i + 1) % 2; j < Size; j += 2)
+            {
+                if (!mtx[i][j])
+                    continue;
+                const bits_t bit = bits_t(1) << square(i, j);
+                (mtx[i][j] % 2 ? r.white : r.black) |= bit;
+                if (mtx[i][j] > 2)
+                    r.kings |= bit;
+            }
+        r.score = pack_score(search_score);
+        r.info = uint16_t(square(turn.x, turn.y) | (square(turn.x2, turn.y2) << 6) | (int(color) << 12) | (int(turn.xb != -1) << 15));
+        return r;
+    }
+
+    template <class Mtx> void to_mtx(Mtx &mtx) const    // Восстановление доски (0 — пусто, 1..4 — как в Board)
+    {
+        for (POS_T i = 0; i < Size; ++i)
+            for (POS_T j = 0; j < Size; ++j)
+                mtx[i][j] = 0;
+        for (int k = 0; k < Squares; ++k)
+            if (const POS_T piece = piece_at(k))
+                mtx[row(k)][col(k)] = piece;
+    }
+
+    POS_T piece_at(const int k) const   // Шашка на тёмной клетке k (0 — пусто, 1..4 — как в Board)
+    {
+        const bits_t bit = bits_t(1) << k;
+        if (!((white | black) & bit))
+            return 0;
+        return POS_T((white & bit ? 1 : 2) + (kings & bit ? 2 : 0));
+    }
+
+    bool color() const  // Очередь хода (false — белые, true — чёрные)
+    {
+        return (info >> 12) & 1;
+    }
+    Game_result result() const
+    {
+        return Game_result((info >> 13) & 3);
+    }
+    void set_result(const Game_result result)
+    {
+        info = uint16_t((info & ~(3 << 13)) | (int(result) << 13));
+    }
+    bool capture() const    // Лучший ход — взятие (взятие обязательно, значит позиция не спокойная)
+    {
+        return (info >> 15) & 1;
+    }
+    move_pos turn() const   // Лучший ход (первый прыжок серии; съеденная шашка не хранится)
+    {
+        const int from = info & 63, to = (info >> 6) & 63;
+        return move_pos(row(from), col(from), row(to), col(to));
+    }
+    double search_score() const // Оценка в шкале calc_score (отношение)
+    {
+        return std::exp(score / 1024.0);
+    }
+
+    static int square(const POS_T i, const POS_T j)    // Номер тёмной клетки
+    {
+        return (i * Size + j) / 2;
+    }
+    static POS_T row(const int k)
+    {
+        return POS_T(2 * k / Size);
+    }
+    static POS_T col(const int k)
+    {
+        return POS_T(2 * k % Size + (row(k) % 2 == 0));
+    }
+
+  private:
+    static int16_t pack_score(const double ratio)
+    {
+        if (!(ratio > 0))
+            return -32767;
+        return int16_t(std::clamp(std::lround(std::log(ratio) * 1024), -32767L, 32767L));
+    }
+};
+
+struct training_header
+{
+    char magic[4] = {'C', 'K', 'T', 'D'};
+    uint32_t version = 2;   // Версия 1 не хранила правила: в один файл попадали позиции разных вариантов 8x8
+    uint32_t board_size = 0;
+    uint32_t record_size = 0;
+    uint64_t rules = 0; // Logic::rules_version (русские, английские и бразильские шашки — все 8x8)
+};
+
+// Дозапись позиций: записи текущей партии копятся в памяти до её конца (тогда известен результат),
+// затем переносятся в буфер записи, который сбрасывается в файл большими блоками.
+template <POS_T Size>
+class Training_writer
+{
+  public:
+    typedef training_record<Size> record;
+
+    ~Training_writer()
+    {
+        close();
+    }
+
+    // Открывает файл на дозапись (создаёт и пишет заголовок, если файла нет); rules — Logic::rules_version
+    bool open(const std::string &path, const uint64_t rules, std::string &error)
+    {
+        close();
+        training_header header;
+        header.board_size = Size;
+        header.record_size = sizeof(record);
+        header.rules = rules;
+        file = std::fopen(path.c_str(), "ab+");
+        if (!file)
+        {
+            error = "can't open " + path;
+            return false;
+        }
+        std::fseek(file, 0, SEEK_END);
+        if (std::ftell(file) == 0)
+            std::fwrite(&header, sizeof(header), 1, file);
+        else
+        {
+            training_header existing;
+            std::fseek(file, 0, SEEK_SET);
+            if (std::fread(&existing, sizeof(existing), 1, file) != 1 || std::memcmp(&existing, &header, sizeof(header)) != 0)
+            {
+                error = path + " is a training file of other format, board size or rules";
+                close();
+                return false;
+            }
+            std::fseek(file, 0, SEEK_END);
+        }
+        buffer.reserve(Buffer_records);
+        return true;
+    }
+
+    bool is_open() const
+    {
+        return file != nullptr;
+    }
+
+    void add(const record &r)  // Позиция текущей партии (результат будет проставлен в end_game)
+    {
+        if (file)
+            game.push_back(r);
+    }
+
+    void end_game(const Game_result result)  // Партия закончилась: проставляет результат и отправляет её позиции в буфер записи
+    {
+        for (auto &r : game)
+        {
+            r.set_result(result);
+            append(r);
+        }
+        game.clear();
+    }
+
+    void append(const record &r)    // Запись с уже известным результатом (минуя позиции текущей партии)
+    {
+        if (!file)
+            return;
+        buffer.push_back(r);
+        if (buffer.size() == Buffer_records)
+            flush();
+    }
+
+    void discard_game()  // Партия прервана (результат неизвестен): её позиции не записываются
+    {
+        game.clear();
+    }
+
+    void flush()    // Сброс буфера в файл
+    {
+        if (file && !buffer.empty())
+        {
+            std::fwrite(buffer.data(), sizeof(record), buffer.size(), file);
+            std::fflush(file);
+        }
+        buffer.clear();
+    }
+
+    void close()
+    {
+        if (!file)
+            return;
+        flush();
+        std::fclose(file);
+        file = nullptr;
+    }
+
+  private:
+    static constexpr size_t Buffer_records = (1 << 20) / sizeof(record); // Около 1 МБ на сброс
+
+    std::FILE *file = nullptr;  // Файл данных
+    std::vector<record> game;   // Позиции текущей партии
+    std::vector<record> buffer; // Позиции законченных партий, ожидающие записи
+};
+
+// Чтение с произвольным доступом: файл отображается в память (mmap), записи доступны по индексу без копирования.
+// На Windows файл читается в память целиком.
+template <POS_T Size>
+class Training_reader
+{
+  public:
+    typedef training_record<Size> record;
+
+    Training_reader() = default;
+    Training_reader(const Training_reader &) = delete;
+    Training_reader &operator=(const Training_reader &) = delete;
+
+    ~Training_reader()
+    {
+        close();
+    }
+
+    bool open(const std::string &path, const uint64_t rules, std::string &error)    // rules — Logic::rules_version
+    {
+        close();
+        if (!file.open(path, error))
+            return false;
+        const char *data = file.data();
+        const size_t size = file.size();
+        training_header expected;
+        expected.board_size = Size;
+        expected.record_size = sizeof(record);
+        expected.rules = rules;
+        if (size < sizeof(training_header) || std::memcmp(data, &expected, sizeof(expected)) != 0)
+        {
+            error = path + " is not a training file for " + std::to_string(Size) + "x" + std::to_string(Size) + " board and these rules";
+            close();
+            return false;
+        }
+        records = reinterpret_cast<const record *>(data + sizeof(training_header));
+        count = (size - sizeof(training_header)) / sizeof(record);  // Недописанный хвост (обрыв записи) отбрасывается
+        return true;
+    }
+
+    void close()
+    {
+        file.close();
+        records = nullptr;
+        count = 0;
+    }
+
+    size_t size() const // Количество записей
+    {
+        return count;
+    }
+
+    const record &operator[](const size_t i) const
+    {
+        return records[i];
+    }
+
+    const record *data() const
+    {
+        return records;
+    }
+
+  private:
+    Mapped_file file;   // Файл данных
+    const record *records = nullptr;    // Первая запись
+    size_t count = 0;
+};
+
+// Перемешанный порядок обхода count записей без таблицы перестановки на все записи: окна по window подряд идущих
+// записей обходятся в случайном порядке, внутри окна — случайная перестановка. Чтение остаётся почти
+// последовательным (окно целиком попадает в кэш страниц), память — O(count / window + window).
+class Shuffled_order
+{
+  public:
+    Shuffled_order(const size_t count, const unsigned seed, const size_t window = 1 << 16)
+        : count(count), window(std::max<size_t>(window, 1)), rng(seed)
+    {
+        for (size_t begin = 0; begin < count; begin += this->window)
+            windows.push_back(begin);
+        std::shuffle(windows.begin(), windows.end(), rng);
+    }
+
+    bool next(size_t &index)    // Следующий индекс; false, когда все записи пройдены
+    {
+        if (pos == current.size())
+        {
+            if (next_window == windows.size())
+                return false;
+            const size_t begin = windows[next_window++];
+            current.resize(std::min(window, count - begin));
+            for (size_t i = 0; i < current.size(); ++i)
+                current[i] = begin + i;
+            std::shuffle(current.begin(), current.end(), rng);
+            pos = 0;
+        }
+        index = current[pos++];
+        return true;
+    }
+
+  private:
+    size_t count;   // Количество записей
+    size_t window;  // Размер окна
+    std::default_random_engine rng;
+    std::vector<size_t> windows;    // Начала окон в случайном порядке
+    size_t next_window = 0;
+    std::vector<size_t> current;    // Перестановка текущего окна
+    size_t pos = 0;
+};
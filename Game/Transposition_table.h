@@ -0,0 +1,283 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+#include "../Models/Move.h"
+
+enum class Bound : uint8_t
+{
+    EXACT,  // Точная оценка
+    LOWER,  // Оценка не меньше сохранённой (было отсечение)
+    UPPER   // Оценка не больше сохранённой (все ходы оказались хуже альфы)
+};
+
+struct tt_entry
+{
+    double score = 0;   // Оценка позиции с точки зрения стороны, для которой начат поиск
+    int depth = 0;      // Оставшаяся глубина, на которую посчитана оценка
+    Bound bound = Bound::EXACT; // Тип оценки
+    move_pos move;      // Лучший ход (или ход, давший отсечение)
+};
+
+inline uint64_t zobrist_key(const uint64_t index) // Ключ Зобриста: splitmix64 от индекса (одинаков во всех процессах и запусках)
+{
+    uint64_t z = (index + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Общая таблица транспозиций. Может использоваться несколькими потоками поиска одновременно без блокировок:
+// каждая запись хранится как пара (ключ ^ данные, данные), поэтому запись, разорванная гонкой, просто не проходит проверку ключа.
+// Таблицу можно отобразить в файл (open): записи переживают перезапуск и видны сразу всем процессам, открывшим тот же файл
+// (та же проверка ключа защищает и от гонок между процессами). Файл: заголовок (magic "CKTT", версия формата,
+// версия оценки, количество записей) и записи подряд.
+class Transposition_table
+{
+  public:
+    explicit Transposition_table(const size_t size_mb)  // Размер таблицы в мегабайтах (округляется вниз до степени двойки записей)
+    {
+        allocate(slots_count(size_mb));
+    }
+
+    Transposition_table(const Transposition_table &) = delete;
+    Transposition_table &operator=(const Transposition_table &) = delete;
+
+    ~Transposition_table()
+    {
+        close();
+    }
+
+    // Переносит таблицу в файл path размером size_mb. Файл другой версии оценки (version) или другого размера
+    // создаётся заново, но только если его не держит другой процесс; иначе таблица остаётся в памяти и возвращается false.
+    // На Windows файл читается в память целиком и записывается обратно в flush (без общего доступа процессов).
+    bool open(const std::string &path, const size_t size_mb, const uint64_t version, std::string &error)
+    {
+        close();
+        cache_header expected;
+        expected.version = version;
+        expected.count = slots_count(size_mb);
+        const size_t bytes = sizeof(cache_header) + expected.count * sizeof(slot);
+#ifndef _WIN32
+        const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+        {
+            error = "can't open " + path;
+            return false;
+        }
+        // Один процесс (исключительная блокировка) может пересоздать файл; пока файл открыт, держится разделяемая блокировка
+        const bool alone = flock(fd, LOCK_EX | LOCK_NB) == 0;
+        if (!alone)
+            flock(fd, LOCK_SH);
+        cache_header existing;
+        const bool valid = ::pread(fd, &existing, sizeof(existing), 0) == ssize_t(sizeof(existing)) &&
+                           std::memcmp(&existing, &expected, sizeof(expected)) == 0;
+        if (!valid)
+        {
+            if (!alone)
+            {
+                ::close(fd);
+                error = path + " is used by a process with other evaluation or size";
+                return false;
+            }
+            if (::ftruncate(fd, 0) != 0 || ::ftruncate(fd, off_t(bytes)) != 0 ||
+                ::pwrite(fd, &expected, sizeof(expected), 0) != ssize_t(sizeof(expected)))
+            {
+                ::close(fd);
+                error = "can't create " + path;
+                return false;
+            }
+        }
+        void *addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED)
+        {
+            ::close(fd);
+            error = "can't map " + path;
+            return false;
+        }
+        if (alone)
+            flock(fd, LOCK_SH);
+        file = fd;
+        mapped = static_cast<char *>(addr);
+        mapped_size = bytes;
+        owned.reset();
+        slots = reinterpret_cast<slot *>(mapped + sizeof(cache_header));
+        mask = expected.count - 1;
+#else
+        allocate(expected.count);
+        std::ifstream fin(path, std::ios_base::binary);
+        cache_header existing;
+        if (fin.read(reinterpret_cast<char *>(&existing), sizeof(existing)) && std::memcmp(&existing, &expected, sizeof(expected)) == 0 &&
+            !fin.read(reinterpret_cast<char *>(slots), std::streamsize(expected.count * sizeof(slot))))
+            clear();    // Файл оборван
+        file_path = path;
+        file_header = expected;
+#endif
+        return true;
+    }
+
+    bool is_persistent() const  // Отображена ли таблица в файл
+    {
+#ifndef _WIN32
+        return mapped != nullptr;
+#else
+        return !file_path.empty();
+#endif
+    }
+
+    void flush()    // Сохранение записей на диск (на Linux — асинхронно, страницы пишет система)
+    {
+#ifndef _WIN32
+        if (mapped)
+            msync(mapped, mapped_size, MS_ASYNC);
+#else
+        if (file_path.empty())
+            return;
+        std::ofstream fout(file_path, std::ios_base::binary | std::ios_base::trunc);
+        fout.write(reinterpret_cast<const char *>(&file_header), sizeof(file_header));
+        fout.write(reinterpret_cast<const char *>(slots), std::streamsize(size() * sizeof(slot)));
+#endif
+    }
+
+    void close()    // Отключение от файла (таблица становится пустой таблицей в памяти того же размера)
+    {
+        if (!is_persistent())
+            return;
+        flush();
+        const size_t count = size();
+#ifndef _WIN32
+        munmap(mapped, mapped_size);
+        ::close(file);  // Снимает и блокировку
+        mapped = nullptr;
+        mapped_size = 0;
+        file = -1;
+#else
+        file_path.clear();
+#endif
+        allocate(count);
+    }
+
+    bool probe(const uint64_t key, tt_entry &entry) const   // Поиск записи по ключу позиции
+    {
+        const slot &s = slots[key & mask];
+        const uint64_t data = s.data.load(std::memory_order_relaxed);
+        if ((s.key.load(std::memory_order_relaxed) ^ data) != key || !data)
+            return false;
+        entry = unpack(data);
+        return true;
+    }
+
+    void store(const uint64_t key, const tt_entry &entry)   // Сохраняет запись, если она не менее глубокая, чем лежащая в ячейке
+    {
+        slot &s = slots[key & mask];
+        const uint64_t old = s.data.load(std::memory_order_relaxed);
+        if ((s.key.load(std::memory_order_relaxed) ^ old) == key && old && unpack(old).depth > entry.depth)
+            return;
+        const uint64_t data = pack(entry);
+        s.key.store(key ^ data, std::memory_order_relaxed);
+        s.data.store(data, std::memory_order_relaxed);
+    }
+
+    void clear()    // Очистка всех записей
+    {
+        for (size_t i = 0; i <= mask; ++i)
+        {
+            slots[i].key.store(0, std::memory_order_relaxed);
+            slots[i].data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    size_t size() const // Количество записей
+    {
+        return mask + 1;
+    }
+
+  private:
+    struct slot
+    {
+        std::atomic<uint64_t> key;
+        std::atomic<uint64_t> data;
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared table needs lock-free 64-bit atomics");
+
+    struct cache_header
+    {
+        char magic[4] = {'C', 'K', 'T', 'T'};
+        uint32_t format = 1;    // Версия формата записей (pack)
+        uint64_t version = 0;   // Версия оценки и правил (Logic::eval_version)
+        uint64_t count = 0;     // Количество записей
+    };
+
+    static size_t slots_count(const size_t size_mb)
+    {
+        size_t count = 1;
+        while (count * 2 * sizeof(slot) <= size_mb * 1024 * 1024)
+            count *= 2;
+        return count;
+    }
+
+    void allocate(const size_t count)   // Пустая таблица в памяти
+    {
+        owned.reset(new slot[count]());
+        slots = owned.get();
+        mask = count - 1;
+    }
+
+    // Упаковка записи в 64 бита: оценка (float, 32 бита) | глубина (6 бит) | тип (2 бита) | ход (6 координат по 4 бита)
+    static uint64_t pack(const tt_entry &entry)
+    {
+        const float score = float(entry.score);
+        uint32_t score_bits;
+        std::memcpy(&score_bits, &score, sizeof(score_bits));
+        uint64_t move_bits = 0;
+        const POS_T coords[] = {entry.move.x, entry.move.y, entry.move.x2, entry.move.y2, entry.move.xb, entry.move.yb};
+        for (int i = 0; i < 6; ++i)
+            move_bits |= uint64_t(coords[i] & 15) << (4 * i);
+        return uint64_t(score_bits) | (uint64_t(std::min(entry.depth, 63)) << 32) | (uint64_t(entry.bound) << 38) | (move_bits << 40);
+    }
+
+    static tt_entry unpack(const uint64_t data)
+    {
+        tt_entry entry;
+        const uint32_t score_bits = uint32_t(data);
+        float score;
+        std::memcpy(&score, &score_bits, sizeof(score));
+        entry.score = score;
+        entry.depth = int((data >> 32) & 63);
+        entry.bound = Bound((data >> 38) & 3);
+        POS_T coords[6];
+        for (int i = 0; i < 6; ++i)
+        {
+            const POS_T c = POS_T((data >> (40 + 4 * i)) & 15);
+            coords[i] = (c == 15 ? -1 : c);
+        }
+        entry.move = move_pos(coords[0], coords[1], coords[2], coords[3], coords[4], coords[5]);
+        return entry;
+    }
+
+    std::unique_ptr<slot[]> owned;  // Записи таблицы в памяти (пусто, если таблица в файле)
+    slot *slots = nullptr;  // Записи таблицы
+    size_t mask = 0;    // Маска индекса (количество записей - 1)
+#ifndef _WIN32
+    int file = -1;  // Дескриптор файла (держит разделяемую блокировку)
+    char *mapped = nullptr; // Отображённый файл
+    size_t mapped_size = 0;
+#else
+    std::string file_path;  // Файл, в который пишет flush
+    cache_header file_header;
+#endif
+};
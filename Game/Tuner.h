@@ -0,0 +1,348 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../Models/Eval_weights.h"
+#include "../Models/Project_path.h"
+#include "Config.h"
+#include "Logger.h"
+#include "Logic.h"
+#include "Training_data.h"
+
+// Подбор весов calc_score по партиям самоигры (режим checkers --tune):
+// 1) потоки играют партии бот против бота и запоминают позиции в формате обучающих данных (Training_data.h);
+//    если задан Tune.DataFile, позиции дописываются в него и обучение идёт по всему файлу (вместе с партиями
+//    прошлых запусков и партиями, записанными игрой через Bot.TrainingFile), файл читается через mmap;
+// 2) используются спокойные позиции (лучший ход — не взятие) с результатом партии (1 — выиграли белые, 0.5 — ничья, 0 — чёрные);
+// 3) веса подбираются как в методе Texel: прогноз P = 1 / (1 + exp(-scale * ln(отношение стоимостей))),
+//    минимизируется средний квадрат ошибки по всем позициям мини-батчами (Adam), градиент батча считается параллельно.
+// Результат записывается в JSON-файл, который движок загружает при запуске (Bot.EvalFile).
+template <class Rules>
+class Tuner
+{
+  public:
+    typedef typename Logic<Rules>::board_mtx board_mtx;
+    static constexpr POS_T Size = Rules::Size;
+    static constexpr int Squares = Size * Size / 2;    // Тёмных клеток (весов на тип шашки)
+
+    explicit Tuner(Config *config) : config(config)
+    {
+        threads_count = std::max(1, int((*config)("Tune", "Threads")));
+    }
+
+    int run()   // Самоигра, подбор весов и запись файла; 0 при успехе
+    {
+        weights = Logic<Rules>(nullptr, config).get_weights();  // Старт с текущих весов (Bot.EvalFile или по умолчанию)
+        self_play();
+        if (!load_data())
+            return 1;
+        weights.scale = fit_scale();
+        report("Initial", loss());
+        fit_weights();
+        weights.scale = fit_scale();
+        report("Final", loss());
+
+        const std::string path = project_path + std::string((*config)("Tune", "Output"));
+        std::ofstream fout(path);
+        fout << json(weights).dump(4) << '\n';
+        if (!fout)
+        {
+            Logger::instance().error("Tune error: can't write " + path);
+            return 1;
+        }
+        Logger::instance().info("Tune weights written", {{"file", path}});
+        std::cout << "Weights written to " << path << std::endl;
+        return 0;
+    }
+
+  private:
+    typedef training_record<Size> record;
+
+    void self_play()    // Параллельная самоигра: Tune.Games партий, по одной на задание
+    {
+        const int games = (*config)("Tune", "Games");
+        std::atomic<int> next_game{0};
+        std::vector<std::vector<record>> found(threads_count);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threads_count; ++t)
+        {
+            threads.emplace_back([&, t] {
+                Logic<Rules> logic(nullptr, config);
+                for (int game; (game = next_game++) < games;)
+                {
+                    logic.set_seed(unsigned(game) * 7919 + 1);
+                    play_game(logic, found[t]);
+                }
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+        for (auto &part : found)
+            samples.insert(samples.end(), part.begin(), part.end());
+        Logger::instance().info("Tune self-play finished", {{"games", games}, {"positions", samples.size()}});
+        std::cout << "Self-play: " << games << " games, " << samples.size() << " positions" << std::endl;
+    }
+
+    void play_game(Logic<Rules> &logic, std::vector<record> &out) const  // Одна партия; позиции получают её результат
+    {
+        const int random_plies = (*config)("Tune", "RandomPlies");
+        const int depth = (*config)("Tune", "Depth");
+        const int max_turns = (*config)("Game", "MaxNumTurns");
+        board_mtx mtx = Logic<Rules>::start_position();
+        const size_t first = out.size();
+        Game_result result = Game_result::DRAW; // Ничья по лимиту ходов или по правилам
+        bool color = false;
+        std::vector<uint64_t> keys{logic.history_key(mtx, color)};  // Позиции с последнего необратимого хода (правила ничьей)
+        for (int turn_num = 0; turn_num < max_turns; ++turn_num, color = !color)
+        {
+            logic.set_history(keys);
+            if (logic.is_draw())
+                break;
+            logic.Max_depth = (turn_num < random_plies ? 0 : depth);    // Первые ходы — мелкий поиск со случайным выбором среди равных
+            auto turns = logic.find_best_turns(mtx, color);
+            if (turns.empty())  // Нет ходов — проигрыш стороны, которая должна ходить
+            {
+                result = (color ? Game_result::WHITE : Game_result::BLACK);
+                break;
+            }
+            if (turn_num >= random_plies)
+                out.push_back(record::make(mtx, color, logic.last_stats().score, turns.front()));
+            const bool reversible = (turns.size() == 1 && logic.is_reversible(mtx, turns.front()));
+            mtx = logic.apply_turns(mtx, turns);
+            if (!reversible)
+                keys.clear();
+            keys.push_back(logic.history_key(mtx, !color));
+        }
+        for (size_t i = first; i < out.size(); ++i)
+            out[i].set_result(result);
+    }
+
+    bool load_data()    // Выбор данных для обучения: позиции самоигры в памяти или весь файл Tune.DataFile
+    {
+        const std::string file = (*config)("Tune", "DataFile");
+        if (!file.empty())
+        {
+            const std::string path = project_path + file;
+            std::string error;
+            Training_writer<Size> writer;
+            if (!writer.open(path, Logic<Rules>::rules_version(), error))
+            {
+                Logger::instance().error("Tune error: " + error);
+                return false;
+            }
+            for (const auto &r : samples)
+                writer.append(r);
+            writer.close();
+            samples = std::vector<record>();
+            if (!reader.open(path, Logic<Rules>::rules_version(), error))
+            {
+                Logger::instance().error("Tune error: " + error);
+                return false;
+            }
+            data = reader.data();
+            count = reader.size();
+            Logger::instance().info("Tune data file", {{"file", path}, {"positions", count}});
+            std::cout << "Data file " << path << ": " << count << " positions" << std::endl;
+        }
+        else
+        {
+            data = samples.data();
+            count = samples.size();
+        }
+        if (!count)
+        {
+            Logger::instance().error("Tune error: no positions to tune on");
+            return false;
+        }
+        return true;
+    }
+
+    static bool usable(const record &r) // Спокойная позиция с известным результатом
+    {
+        return !r.capture() && r.result() != Game_result::UNKNOWN;
+    }
+
+    static double target(const record &r)   // 1 — победа белых, 0.5 — ничья, 0 — победа чёрных
+    {
+        return r.result() == Game_result::WHITE ? 1 : r.result() == Game_result::BLACK ? 0 : 0.5;
+    }
+
+    // Логит выигрыша белых для позиции: scale * (ln W - ln B); W и B — суммы стоимостей шашек сторон
+    double logit(const record &r, const eval_weights &w, double &white, double &black) const
+    {
+        white = black = 0;
+        for (int k = 0; k < Squares; ++k)
+        {
+            const POS_T piece = r.piece_at(k);
+            if (!piece)
+                continue;
+            const POS_T i = record::row(k), j = record::col(k);
+            const double value = (piece <= 2 ? w.man : w.king)[eval_weights::square(i, j, piece, Size)];
+            (piece % 2 ? white : black) += value;
+        }
+        return w.scale * (std::log(std::max(white, 1e-9)) - std::log(std::max(black, 1e-9)));
+    }
+
+    static double sigmoid(const double x)
+    {
+        return 1 / (1 + std::exp(-x));
+    }
+
+    double loss()   // Средний квадрат ошибки прогноза по всем позициям (параллельно)
+    {
+        std::vector<double> parts(threads_count, 0);
+        std::vector<size_t> used(threads_count, 0);
+        parallel(count, [&](const int t, const size_t from, const size_t to) {
+            double white, black;
+            for (size_t i = from; i < to; ++i)
+            {
+                if (!usable(data[i]))
+                    continue;
+                const double err = sigmoid(logit(data[i], weights, white, black)) - target(data[i]);
+                parts[t] += err * err;
+                ++used[t];
+            }
+        });
+        double sum = 0;
+        size_t total = 0;
+        for (int t = 0; t < threads_count; ++t)
+        {
+            sum += parts[t];
+            total += used[t];
+        }
+        return total ? sum / total : 0;
+    }
+
+    double fit_scale()  // Масштаб Texel: минимум ошибки по scale при фиксированных весах (поиск золотым сечением)
+    {
+        double lo = 0.05, hi = 20;
+        const double ratio = (std::sqrt(5.0) - 1) / 2;
+        for (int it = 0; it < 40; ++it)
+        {
+            const double a = hi - ratio * (hi - lo), b = lo + ratio * (hi - lo);
+            weights.scale = a;
+            const double loss_a = loss();
+            weights.scale = b;
+            const double loss_b = loss();
+            if (loss_a < loss_b)
+                hi = b;
+            else
+                lo = a;
+        }
+        return (lo + hi) / 2;
+    }
+
+    void fit_weights()  // Мини-батчевый градиентный спуск (Adam) по весам шашек и дамок
+    {
+        const int epochs = (*config)("Tune", "Epochs");
+        const size_t batch_size = std::max(1, int((*config)("Tune", "BatchSize")));
+        const double rate = (*config)("Tune", "LearningRate");
+        const int params = 2 * Squares;  // [0, Squares) — шашки, [Squares, 2 * Squares) — дамки
+        std::vector<double> m(params, 0), v(params, 0);
+        std::vector<size_t> batch;
+        batch.reserve(batch_size);
+        int step = 0;
+        for (int epoch = 0; epoch < epochs; ++epoch)
+        {
+            Shuffled_order order(count, unsigned(epoch));   // Перемешивание окнами: память не зависит от размера файла
+            for (size_t index; ; batch.clear())
+            {
+                while (batch.size() < batch_size && order.next(index))
+                    if (usable(data[index]))
+                        batch.push_back(index);
+                if (batch.empty())
+                    break;
+                std::vector<std::vector<double>> parts(threads_count, std::vector<double>(params, 0));
+                parallel(batch.size(), [&](const int t, const size_t from, const size_t to) {
+                    for (size_t k = from; k < to; ++k)
+                        add_gradient(data[batch[k]], parts[t]);
+                });
+                ++step;
+                for (int p = 0; p < params; ++p)
+                {
+                    double g = 0;
+                    for (const auto &part : parts)
+                        g += part[p];
+                    g /= double(batch.size());
+                    m[p] = 0.9 * m[p] + 0.1 * g;
+                    v[p] = 0.999 * v[p] + 0.001 * g * g;
+                    const double m_hat = m[p] / (1 - std::pow(0.9, step)), v_hat = v[p] / (1 - std::pow(0.999, step));
+                    double &w = (p < Squares ? weights.man[p] : weights.king[p - Squares]);
+                    w = std::max(0.05, w - rate * m_hat / (std::sqrt(v_hat) + 1e-8));   // Стоимость шашки должна оставаться положительной
+                }
+            }
+            normalize();
+            if ((epoch + 1) % std::max(1, epochs / 10) == 0)
+                report("Epoch " + std::to_string(epoch + 1), loss());
+        }
+    }
+
+    void add_gradient(const record &r, std::vector<double> &grad) const    // Градиент квадрата ошибки одной позиции по весам
+    {
+        double white, black;
+        const double p = sigmoid(logit(r, weights, white, black));
+        const double d_logit = 2 * (p - target(r)) * p * (1 - p) * weights.scale;
+        for (int k = 0; k < Squares; ++k)
+        {
+            const POS_T piece = r.piece_at(k);
+            if (!piece)
+                continue;
+            const POS_T i = record::row(k), j = record::col(k);
+            const int index = eval_weights::square(i, j, piece, Size) + (piece <= 2 ? 0 : Squares);
+            grad[index] += (piece % 2 ? d_logit / white : -d_logit / black);   // d ln W / dw = 1 / W, d ln B / dw = 1 / B
+        }
+    }
+
+    void normalize()    // Оценка — отношение, поэтому общий масштаб весов произволен: средняя стоимость шашки приводится к 1
+    {
+        double mean = 0;
+        for (const double w : weights.man)
+            mean += w;
+        mean /= weights.man.size();
+        for (auto &w : weights.man)
+            w /= mean;
+        for (auto &w : weights.king)
+            w /= mean;
+    }
+
+    template <class Func> void parallel(const size_t count, Func func)  // Делит [0, count) на Tune.Threads частей и обрабатывает их параллельно
+    {
+        std::vector<std::thread> threads;
+        const size_t chunk = (count + threads_count - 1) / threads_count;
+        for (int t = 0; t < threads_count; ++t)
+        {
+            const size_t from = std::min(count, t * chunk), to = std::min(count, from + chunk);
+            if (from < to)
+                threads.emplace_back(func, t, from, to);
+        }
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+    void report(const std::string &stage, const double mse) const  // Прогресс подбора в лог и на консоль
+    {
+        double man = 0, king = 0;
+        for (int k = 0; k < Squares; ++k)
+        {
+            man += weights.man[k];
+            king += weights.king[k];
+        }
+        Logger::instance().info("Tune " + stage, {{"mse", mse}, {"scale", weights.scale}, {"king_to_man", king / man}});
+        std::cout << stage << ": mse " << mse << ", scale " << weights.scale << ", king/man " << king / man << std::endl;
+    }
+
+  private:
+    Config *config; // Конфигурация (раздел Tune)
+    int threads_count = 1;  // Потоков самоигры и подсчёта градиента
+    eval_weights weights;   // Подбираемые веса
+    std::vector<record> samples;    // Позиции самоигры с результатами
+    Training_reader<Size> reader;   // Файл Tune.DataFile (если задан)
+    const record *data = nullptr;   // Позиции для обучения (samples или отображённый файл)
+    size_t count = 0;
+};
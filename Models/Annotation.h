@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <vector>
+
+struct move_annotation  //     
+{
+    int ply = 0;                //   (0    )
+    std::string move;           //   ("c3-d4",   "c3:e5")
+    std::string best;           //     (,      )
+    double score = 0;           //   : ln    ,   (+-100  /)
+    double best_score = 0;      //       
+    double swing = 0;           //  : best_score - score (0,    )
+    bool missed_win = false;    //   ,     
+    std::string mark;           // "??"   , "?"  ,     
+};
+
+struct game_annotation  //  
+{
+    size_t game = 0;            //     ( 0    )
+    std::string result;         // "white", "black"  "draw"
+    std::vector<move_annotation> moves;
+    int blunders = 0;           //    "??"
+    int mistakes = 0;           //    "?"
+    int missed_wins = 0;        //  
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+
+#include "Move.h"
+
+//   calc_score:              
+// (   ).        .
+struct eval_weights
+{
+    std::vector<double> man;        //      
+    std::vector<double> king;       //     
+    double scale = 1;               //  Texel: P() = 1 / (1 + exp(-scale * ln()))
+
+    eval_weights() = default;
+    explicit eval_weights(const POS_T size) : man(size * size / 2, 1.0), king(size * size / 2, 4.0) //   :  1,  4
+    {
+    }
+
+    static int square(POS_T i, POS_T j, const POS_T piece, const POS_T size)  //    (i, j)      piece
+    {
+        if (piece % 2 == 0)     // ׸:  
+        {
+            i = size - 1 - i;
+            j = size - 1 - j;
+        }
+        return (i * size + j) / 2;
+    }
+};
@@ -0,0 +1,102 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "Move.h"
+
+inline int lowest_bit(const uint64_t mask)  //     (mask != 0)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return int(index);
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+inline int highest_bit(const uint64_t mask) //     (mask != 0)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, mask);
+    return int(index);
+#else
+    return 63 - __builtin_clzll(mask);
+#endif
+}
+
+//   :               .
+//     move_series::captured: (i * Size + j) / 2.    ,  
+//             ,     .
+//    .
+template <POS_T Size> struct king_rays
+{
+    static constexpr int Squares = Size * Size / 2;
+    static constexpr int Directions = 4;    // -, -, -, - (  )
+    static constexpr POS_T Di[Directions] = {-1, -1, 1, 1};
+    static constexpr POS_T Dj[Directions] = {-1, 1, -1, 1};
+
+    static_assert(Squares <= 64, "Board does not fit into 64-bit masks");
+
+    static constexpr int square(const POS_T i, const POS_T j)  //   
+    {
+        return (i * Size + j) / 2;
+    }
+    static constexpr POS_T row(const int k)
+    {
+        return POS_T(2 * k / Size);
+    }
+    static constexpr POS_T col(const int k)
+    {
+        return POS_T(2 * k % Size + (row(k) % 2 == 0));
+    }
+    static constexpr uint64_t bit(const POS_T i, const POS_T j)
+    {
+        return uint64_t(1) << square(i, j);
+    }
+
+    static uint64_t ray(const int k, const int d)   //     k (  k)
+    {
+        return masks[k][d];
+    }
+
+    static int nearest(const int k, const int d, const uint64_t occupied) //      -1
+    {
+        const uint64_t hit = masks[k][d] & occupied;
+        if (!hit)
+            return -1;
+        return d < 2 ? highest_bit(hit) : lowest_bit(hit);
+    }
+
+    static uint64_t free_squares(const int k, const int d, const uint64_t occupied)   //      
+    {
+        const int stop = nearest(k, d, occupied);
+        return stop < 0 ? masks[k][d] : masks[k][d] & ~(masks[stop][d] | uint64_t(1) << stop);
+    }
+
+    static int pop_nearest(uint64_t &squares, const int d)  //     ,    
+    {
+        const int k = d < 2 ? highest_bit(squares) : lowest_bit(squares);
+        squares &= ~(uint64_t(1) << k);
+        return k;
+    }
+
+  private:
+    typedef std::array<std::array<uint64_t, Directions>, Squares> table_t;
+
+    static constexpr table_t build()
+    {
+        table_t res{};
+        for (int k = 0; k < Squares; ++k)
+            for (int d = 0; d < Directions; ++d)
+                for (int i = row(k) + Di[d], j = col(k) + Dj[d]; i >= 0 && i < Size && j >= 0 && j < Size; i += Di[d], j += Dj[d])
+                    res[k][d] |= uint64_t(1) << square(POS_T(i), POS_T(j));
+        return res;
+    }
+
+    static constexpr table_t masks = build();
+};
@@ -0,0 +1,9 @@
+#pragma once
+
+enum class Log_level
+{
+    DEBUG,          //    (,  )
+    INFO,           //   :  ,  
+    WARNING,        // ,   
+    ERROR           //  SDL,    ..
+};
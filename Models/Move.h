@@ -9,6 +9,9 @@ struct move_pos
     POS_T x2, y2;           //    (  )
     POS_T xb = -1, yb = -1; //    (  -1,   )
 
+    move_pos() : x(-1), y(-1), x2(-1), y2(-1) //   (    )
+    {
+    }
     move_pos(const POS_T x, const POS_T y, const POS_T x2, const POS_T y2) : x(x), y(y), x2(x2), y2(y2) //      
     {
     }
@@ -0,0 +1,85 @@
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+#include "Move.h"
+
+template <size_t N, class Move = move_pos> struct move_list    //       (    )
+{
+    template <class... Args> void emplace_back(Args... args)    //      std::vector
+    {
+        if (count == N) //      assert:      ,  
+        {
+            ++dropped;
+            return;
+        }
+        moves[count++] = Move(args...);
+    }
+
+    void push_back(const Move &move)
+    {
+        if (count == N)
+        {
+            ++dropped;
+            return;
+        }
+        moves[count++] = move;
+    }
+
+    void clear()
+    {
+        count = 0;
+        dropped = 0;
+    }
+
+    void resize(const size_t n) //   (   n )
+    {
+        assert(n <= count && "move_list can only shrink");
+        count = n;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    Move &operator[](const size_t i)
+    {
+        return moves[i];
+    }
+
+    const Move &operator[](const size_t i) const
+    {
+        return moves[i];
+    }
+
+    Move *begin()
+    {
+        return moves.data();
+    }
+
+    Move *end()
+    {
+        return moves.data() + count;
+    }
+
+    const Move *begin() const
+    {
+        return moves.data();
+    }
+
+    const Move *end() const
+    {
+        return moves.data() + count;
+    }
+
+    std::array<Move, N> moves;  //  
+    size_t count = 0;   //   
+    size_t dropped = 0; // ,     (0      )
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Move.h"
+
+struct hop_pos  //   : ,   ,   
+{
+    POS_T x2, y2;
+    POS_T xb, yb;
+};
+
+//  ,    :         (  ).
+//         ,       .
+template <POS_T Size> struct move_series
+{
+    static constexpr int Max_hops = Size * (Size - 2) / 4;  //          
+
+    POS_T x, y;             //  
+    POS_T x2, y2;           //  
+    uint8_t hops;           //   (0   )
+    bool crown;             //   
+    uint64_t captured;      //  :  (i * Size + j) / 2   
+    std::array<hop_pos, Max_hops> hop;  //   
+
+    //   :         
+
+    static move_series quiet(const move_pos &turn, const bool crown)  //   (crown       )
+    {
+        move_series res;
+        res.x = turn.x;
+        res.y = turn.y;
+        res.x2 = turn.x2;
+        res.y2 = turn.y2;
+        res.hops = 0;
+        res.crown = crown;
+        res.captured = 0;
+        return res;
+    }
+
+    static uint64_t bit(const POS_T i, const POS_T j)   //     captured
+    {
+        return uint64_t(1) << ((i * Size + j) / 2);
+    }
+
+    move_pos key() const    //     : ,     
+    {
+        return hops ? move_pos(x, y, x2, y2, hop[0].xb, hop[0].yb) : move_pos(x, y, x2, y2);
+    }
+
+    bool matches(const move_pos &turn) const    //       key()
+    {
+        return turn == key() && turn.xb == (hops ? hop[0].xb : -1) && turn.yb == (hops ? hop[0].yb : -1);
+    }
+
+    bool same_position(const move_series &other) const //      (    )
+    {
+        return x == other.x && y == other.y && x2 == other.x2 && y2 == other.y2 && captured == other.captured && crown == other.crown;
+    }
+
+    std::vector<move_pos> to_turns() const  //      (   )
+    {
+        if (!hops)
+            return {move_pos(x, y, x2, y2)};
+        std::vector<move_pos> res;
+        POS_T from_x = x, from_y = y;
+        for (int k = 0; k < hops; ++k)
+        {
+            res.emplace_back(from_x, from_y, hop[k].x2, hop[k].y2, hop[k].xb, hop[k].yb);
+            from_x = hop[k].x2;
+            from_y = hop[k].y2;
+        }
+        return res;
+    }
+};
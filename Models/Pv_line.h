@@ -0,0 +1,11 @@
+#pragma once
+#include <vector>
+
+#include "Move.h"
+
+struct pv_line  //   (multi-PV):  ,     
+{
+    double score = 0;               //     ,     (  )
+    std::vector<move_pos> turn;     //  ,     (    )
+    std::vector<move_pos> pv;       //     (,    )
+};
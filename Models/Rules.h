@@ -0,0 +1,52 @@
+#pragma once
+#include "Move.h"
+
+enum class Crowning
+{
+    CONTINUE,       // ,     ,     
+    STOP,           //     ,     
+    AT_END          //   ,       
+};
+
+//       : Logic  Game   
+//  ,            .
+
+struct russian_rules    //  : 8x8,   ,  
+{
+    static constexpr POS_T Size = 8;                    //  
+    static constexpr bool Men_capture_backward = true;  //    
+    static constexpr bool Flying_kings = true;          //       
+    static constexpr bool Majority_capture = false;     //     
+    static constexpr Crowning Crowning_rule = Crowning::CONTINUE;   //      
+    static constexpr int King_moves_draw = 15;          // ,           
+};
+
+struct english_rules    //  () : 8x8,    ,    
+{
+    static constexpr POS_T Size = 8;
+    static constexpr bool Men_capture_backward = false;
+    static constexpr bool Flying_kings = false;
+    static constexpr bool Majority_capture = false;
+    static constexpr Crowning Crowning_rule = Crowning::STOP;
+    static constexpr int King_moves_draw = 40;
+};
+
+struct brazilian_rules  //  :      8x8
+{
+    static constexpr POS_T Size = 8;
+    static constexpr bool Men_capture_backward = true;
+    static constexpr bool Flying_kings = true;
+    static constexpr bool Majority_capture = true;
+    static constexpr Crowning Crowning_rule = Crowning::AT_END;
+    static constexpr int King_moves_draw = 20;
+};
+
+struct international_rules  //  : 10x10,  
+{
+    static constexpr POS_T Size = 10;
+    static constexpr bool Men_capture_backward = true;
+    static constexpr bool Flying_kings = true;
+    static constexpr bool Majority_capture = true;
+    static constexpr Crowning Crowning_rule = Crowning::AT_END;
+    static constexpr int King_moves_draw = 25;
+};
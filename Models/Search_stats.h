@@ -0,0 +1,54 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+struct search_iteration
+{
+    int depth = 0;          //   ( ,     )
+    uint64_t nodes = 0;     //  ,    
+    double time_ms = 0;     //    
+};
+
+struct search_stats
+{
+    bool color = false;             // ,     (0  , 1  )
+    int depth = 0;                  //   
+    int seldepth = 0;               //   ( ;     )
+    uint64_t nodes = 0;             //   
+    uint64_t leaves = 0;            // ,   calc_score
+    uint64_t interior = 0;          // ,    
+    uint64_t beta_cutoffs = 0;      //  - 
+    uint64_t first_move_cutoffs = 0;    // ,     
+    uint64_t hash_probes = 0;       //    
+    uint64_t hash_hits = 0;         //     
+    uint64_t draws = 0;             // ,      (,   )
+    double time_ms = 0;             //     
+    double score = 0;               //    (    color)
+    std::vector<search_iteration> iterations;   //   
+
+    double nps() const  //   
+    {
+        return time_ms > 0 ? nodes * 1000.0 / time_ms : 0;
+    }
+
+    double cutoff_rate() const  //   ,  
+    {
+        return interior ? double(beta_cutoffs) / interior : 0;
+    }
+
+    double first_move_cutoff_rate() const   //      (  )
+    {
+        return beta_cutoffs ? double(first_move_cutoffs) / beta_cutoffs : 0;
+    }
+
+    double branching_factor() const //   : nodes^(1/depth)
+    {
+        return depth > 0 && nodes > 1 ? std::pow(double(nodes), 1.0 / depth) : 0;
+    }
+
+    double hash_hit_rate() const    //     
+    {
+        return hash_probes ? double(hash_hits) / hash_probes : 0;
+    }
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Move.h"
+
+enum class Solve_result : uint8_t
+{
+    UNKNOWN,    //   (    )
+    WIN,        // ,  ,    
+    LOSS,       // ,  ,    
+    DRAW        //       
+};
+
+struct solution
+{
+    Solve_result result = Solve_result::UNKNOWN;    //   ,  
+    std::vector<std::vector<move_pos>> line;    //  :     (    )
+    uint64_t nodes = 0;     //  
+    double time_ms = 0;     //    
+    bool cached = false;    //      
+};
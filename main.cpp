@@ -1,9 +1,90 @@
 #include "Game/Game.h"
+#include "Game/Annotator.h"
+#include "Game/Database_builder.h"
+#include "Game/Movegen_check.h"
+#include "Game/Nnue_trainer.h"
+#include "Game/Server.h"
+#include "Game/Tuner.h"
+
+template <class Rules> int run(const string &mode)   // Запускает игру, сервер анализа (--server), подбор весов (--tune), обучение нейросетевой оценки (--train-nnue), построение индекса базы партий (--build-db) разбор партий (--annotate) или игру с записью (--record-input) и воспроизведением (--replay-input) ввода по правилам варианта Rules
+{
+    if (mode == "--annotate")
+    {
+        Config config;
+        Logger::instance().open(project_path + "annotate_log.txt");
+        Annotator<Rules> annotator(&config);
+        return annotator.run();
+    }
+    if (mode == "--build-db")
+    {
+        Config config;
+        Logger::instance().open(project_path + "db_log.txt");
+        Database_builder<Rules> builder(&config);
+        return builder.run();
+    }
+    if (mode == "--tune")
+    {
+        Config config;
+        Logger::instance().open(project_path + "tune_log.txt");
+        Tuner<Rules> tuner(&config);
+        return tuner.run();
+    }
+    if (mode == "--train-nnue")
+    {
+        Config config;
+        Logger::instance().open(project_path + "nnue_log.txt");
+        Nnue_trainer<Rules> trainer(&config);
+        return trainer.run();
+    }
+    if (mode == "--server")
+    {
+#ifndef _WIN32
+        Config config;
+        Logger::instance().open(project_path + "server_log.txt");
+        Server<Rules> s(&config);
+        return s.run();
+#else
+        cerr << "Server mode is not supported on Windows" << endl;
+        return 1;
+#endif
+    }
+    Game<Rules> g;
+    if (mode == "--record-input" || mode == "--replay-input")
+        return g.play_input_log(mode == "--replay-input");
+    return g.play();
+}
+
+int check_movegen()    // Сравнивает генератор ходов всех вариантов с эталонным на случайных позициях (--check-movegen)
+{
+    Config config;
+    Logger::instance().open(project_path + "movegen_log.txt");
+    const size_t positions = 100000;    // Позиций на вариант
+    int res = 0;
+    res |= Movegen_check<russian_rules>(&config, "Russian").run(positions, 1);
+    res |= Movegen_check<english_rules>(&config, "English").run(positions, 2);
+    res |= Movegen_check<brazilian_rules>(&config, "Brazilian").run(positions, 3);
+    res |= Movegen_check<international_rules>(&config, "International").run(positions, 4);
+    return res;
+}
 
 int main(int argc, char* argv[])
 {
-    Game g;
-    g.play();
+    TRACE_THREAD_NAME("main");
+    const string mode = (argc > 1 ? argv[1] : "");  // checkers --server — сервер анализа, checkers --tune — подбор весов оценки, checkers --train-nnue — обучение нейросетевой оценки, checkers --build-db — индекс базы партий, checkers --annotate — разбор партий, checkers --record-input / --replay-input — запись / воспроизведение ввода, checkers --check-movegen — проверка генератора ходов
+    const string variant = Config()("Game", "Variant");   // Вариант правил из settings.json
+    int res;
+    if (mode == "--check-movegen")  // Проверяются все варианты, Game.Variant не важен
+        res = check_movegen();
+    else if (variant == "English")
+        res = run<english_rules>(mode);
+    else if (variant == "Brazilian")
+        res = run<brazilian_rules>(mode);
+    else if (variant == "International")
+        res = run<international_rules>(mode);
+    else
+        res = run<russian_rules>(mode);
+    TRACE_DUMP(project_path + "trace.json");    // Только в сборке с -DCHECKERS_TRACE
 
-    return 0;
+    return (mode == "--server" || mode == "--tune" || mode == "--train-nnue" || mode == "--build-db" || mode == "--annotate" ||
+            mode == "--record-input" || mode == "--replay-input" || mode == "--check-movegen") ? res : 0;    // Результат партии не является кодом ошибки
 }